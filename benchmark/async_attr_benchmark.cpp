@@ -0,0 +1,67 @@
+#include <catch2/catch_all.hpp>
+#include "async_attr.hpp"
+#include "observable_attr.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace {
+    // Stands in for re-indexing or persistence: a couple of microseconds of work per change.
+    struct slow_side_effect {
+        std::atomic<std::uint64_t> sink{0};
+
+        void operator()(const int&value) {
+            std::uint64_t hash = static_cast<std::uint64_t>(value);
+            const auto until = std::chrono::steady_clock::now() + std::chrono::microseconds(2);
+            while (std::chrono::steady_clock::now() < until) {
+                hash = hash * 0x9E3779B97F4A7C15ull + 1;
+            }
+            sink.fetch_add(hash, std::memory_order_relaxed);
+        }
+    };
+}
+
+// Time the writer spends in one write. Synchronously the side effect is part of it;
+// dispatched asynchronously the writer only posts a change record. The blocking queue is
+// large enough that the writer runs ahead of the consumer for the whole measurement.
+TEST_CASE("writer-side latency of change side effects", "[benchmark][async_attr]") {
+    int next = 0;
+
+    touka::attr<int> plain(0);
+    BENCHMARK("attr write, no side effect") {
+        plain = ++next;
+        return plain.get();
+    };
+
+    slow_side_effect inline_effect;
+    touka::observable_attr<int> observed(0);
+    observed.subscribe(inline_effect);
+    BENCHMARK("observable_attr write, side effect inline") {
+        observed = ++next;
+        return observed.get();
+    };
+
+    slow_side_effect dispatched_effect;
+    touka::change_dispatcher dispatcher(1 << 20);
+
+    touka::async_attr<int> coalescing(dispatcher, dispatched_effect, touka::backpressure::coalesce);
+    BENCHMARK("async_attr write, coalesce") {
+        coalescing = ++next;
+        return coalescing.get();
+    };
+
+    touka::async_attr<int> dropping(dispatcher, dispatched_effect, touka::backpressure::drop);
+    BENCHMARK("async_attr write, drop") {
+        dropping = ++next;
+        return dropping.get();
+    };
+    dispatcher.flush();
+
+    touka::async_attr<int> blocking(dispatcher, dispatched_effect, touka::backpressure::block);
+    BENCHMARK("async_attr write, block") {
+        blocking = ++next;
+        return blocking.get();
+    };
+    dispatcher.flush();
+}
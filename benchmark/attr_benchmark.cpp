@@ -0,0 +1,129 @@
+#include <catch2/catch_all.hpp>
+#include "attr.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+    struct quote {
+        double bid;
+        double ask;
+        long long volume;
+        int venue;
+        int flags;
+    };
+
+    constexpr std::size_t element_count = 1 << 16;
+
+    int make_int(std::size_t i) { return static_cast<int>(i); }
+
+    quote make_quote(std::size_t i) {
+        return quote{static_cast<double>(i), static_cast<double>(i) + 0.5, static_cast<long long>(i), 1, 0};
+    }
+
+    // Deterministic keys long enough to defeat the small-string buffer.
+    std::vector<std::string> make_words(std::size_t count) {
+        std::vector<std::string> words;
+        words.reserve(count);
+        std::uint32_t state = 2463534242u;
+        for (std::size_t i = 0; i < count; ++i) {
+            std::string word(24, ' ');
+            for (char&c : word) {
+                state ^= state << 13;
+                state ^= state >> 17;
+                state ^= state << 5;
+                c = static_cast<char>('a' + state % 26);
+            }
+            words.push_back(std::move(word));
+        }
+        return words;
+    }
+
+    template<typename Element>
+    std::vector<Element> convert(const std::vector<std::string>&words) {
+        std::vector<Element> converted;
+        converted.reserve(words.size());
+        for (const auto&word : words) {
+            converted.emplace_back(word);
+        }
+        return converted;
+    }
+
+    template<typename Element>
+    std::size_t sum_lookups(const std::unordered_map<Element, std::size_t>&map, const std::vector<Element>&keys) {
+        std::size_t sum = 0;
+        for (const auto&key : keys) {
+            sum += map.find(key)->second;
+        }
+        return sum;
+    }
+
+    // Push without reserve() so the vector reallocates and relocates its elements log(n) times.
+    template<typename Element, auto Make>
+    std::size_t grow() {
+        std::vector<Element> values;
+        for (std::size_t i = 0; i < element_count; ++i) {
+            values.emplace_back(Make(i));
+        }
+        return values.size();
+    }
+}
+
+TEST_CASE("vector growth of attrs versus raw values", "[benchmark][relocate]") {
+    BENCHMARK("vector<int>") { return grow<int, make_int>(); };
+    BENCHMARK("vector<attr_impl<int>>") { return grow<touka::attr_impl<int>, make_int>(); };
+    BENCHMARK("vector<quote>") { return grow<quote, make_quote>(); };
+    BENCHMARK("vector<attr_impl<quote>>") { return grow<touka::attr_impl<quote>, make_quote>(); };
+}
+
+TEST_CASE("sorting and hashing attrs versus raw values", "[benchmark][compare]") {
+    const auto words = make_words(4096);
+    const auto string_attrs = convert<touka::attr<std::string>>(words);
+
+    BENCHMARK_ADVANCED("sort vector<std::string>")(Catch::Benchmark::Chronometer meter) {
+        std::vector<std::vector<std::string>> runs(meter.runs(), words);
+        meter.measure([&](int i) { std::sort(runs[i].begin(), runs[i].end()); return runs[i].size(); });
+    };
+
+    BENCHMARK_ADVANCED("sort vector<attr<std::string>>")(Catch::Benchmark::Chronometer meter) {
+        std::vector<std::vector<touka::attr<std::string>>> runs(meter.runs(), string_attrs);
+        meter.measure([&](int i) { std::sort(runs[i].begin(), runs[i].end()); return runs[i].size(); });
+    };
+
+    std::unordered_map<std::string, std::size_t> string_map;
+    std::unordered_map<touka::attr<std::string>, std::size_t> attr_map;
+    for (std::size_t i = 0; i < words.size(); ++i) {
+        string_map.emplace(words[i], i);
+        attr_map.emplace(string_attrs[i], i);
+    }
+
+    BENCHMARK("unordered_map<std::string> lookup") { return sum_lookups(string_map, words); };
+    BENCHMARK("unordered_map<attr<std::string>> lookup") { return sum_lookups(attr_map, string_attrs); };
+}
+
+TEST_CASE("compound operators on attrs versus raw values", "[benchmark][compound]") {
+    // Opaque to the optimizer so the loops below cannot be folded into a constant.
+    volatile int step = 1;
+
+    BENCHMARK("int += / ++") {
+        int counter = 0;
+        for (std::size_t i = 0; i < element_count; ++i) {
+            counter += step;
+            ++counter;
+        }
+        return counter;
+    };
+
+    BENCHMARK("attr<int> += / ++") {
+        touka::attr<int> counter(0);
+        for (std::size_t i = 0; i < element_count; ++i) {
+            counter += step;
+            ++counter;
+        }
+        return *counter;
+    };
+}
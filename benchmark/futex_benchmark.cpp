@@ -0,0 +1,141 @@
+#include <catch2/catch_all.hpp>
+#include "atomic_attr.hpp"
+#include "sync.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+namespace {
+    // A responder thread that echoes every value it is woken with, so one benchmark
+    // iteration is a full set-to-wakeup round trip in each direction.
+    class futex_ping_pong {
+    public:
+        futex_ping_pong() : _responder([this] { respond(); }) {
+        }
+
+        ~futex_ping_pong() {
+            round_trip(-1);
+            _responder.join();
+        }
+
+        int round_trip(int value) {
+            const int previous = _pong.get();
+            _ping = value;
+            _ping.notify_one();
+            _pong.wait(previous);
+            return _pong.get();
+        }
+
+    private:
+        void respond() {
+            int seen = 0;
+            while (seen != -1) {
+                _ping.wait(seen);
+                seen = _ping.get();
+                _pong = seen;
+                _pong.notify_one();
+            }
+        }
+
+        touka::atomic_attr<int> _ping{0};
+        touka::atomic_attr<int> _pong{0};
+        std::thread _responder;
+    };
+
+    // The same exchange over a versioned attr, which wakes waiters from its setter.
+    class versioned_ping_pong {
+    public:
+        versioned_ping_pong() : _responder([this] { respond(); }) {
+        }
+
+        ~versioned_ping_pong() {
+            round_trip(-1);
+            _responder.join();
+        }
+
+        int round_trip(int value) {
+            const auto seen = _pong.version();
+            _ping = value;
+            _pong.wait_for_change(seen);
+            return _pong.get();
+        }
+
+    private:
+        using shared_int = touka::attr_impl<int, touka::default_getter<int>, touka::default_setter<int>,
+            touka::sync::versioned<touka::sync::spinlock>>;
+
+        void respond() {
+            std::uint64_t seen = 0;
+            int value = 0;
+            while (value != -1) {
+                _ping.wait_for_change(seen);
+                seen = _ping.version();
+                value = _ping.get();
+                _pong = value;
+            }
+        }
+
+        shared_int _ping{0};
+        shared_int _pong{0};
+        std::thread _responder;
+    };
+
+    // The hand-rolled alternative: a value guarded by a mutex and a condition variable.
+    class condition_ping_pong {
+    public:
+        condition_ping_pong() : _responder([this] { respond(); }) {
+        }
+
+        ~condition_ping_pong() {
+            round_trip(-1);
+            _responder.join();
+        }
+
+        int round_trip(int value) {
+            std::unique_lock lock(_mutex);
+            _ping = value;
+            _pinged = true;
+            _changed.notify_all();
+            _changed.wait(lock, [this] { return _ponged; });
+            _ponged = false;
+            return _pong;
+        }
+
+    private:
+        void respond() {
+            std::unique_lock lock(_mutex);
+            int value = 0;
+            while (value != -1) {
+                _changed.wait(lock, [this] { return _pinged; });
+                _pinged = false;
+                value = _ping;
+                _pong = value;
+                _ponged = true;
+                _changed.notify_all();
+            }
+        }
+
+        std::mutex _mutex;
+        std::condition_variable _changed;
+        int _ping = 0;
+        int _pong = 0;
+        bool _pinged = false;
+        bool _ponged = false;
+        std::thread _responder;
+    };
+}
+
+TEST_CASE("set-to-wakeup latency", "[benchmark][wait]") {
+    int next = 0;
+
+    futex_ping_pong futex;
+    BENCHMARK("atomic_attr wait/notify round trip") { return futex.round_trip(++next); };
+
+    versioned_ping_pong versioned;
+    BENCHMARK("versioned attr wait_for_change round trip") { return versioned.round_trip(++next); };
+
+    condition_ping_pong condition;
+    BENCHMARK("mutex + condition_variable round trip") { return condition.round_trip(++next); };
+}
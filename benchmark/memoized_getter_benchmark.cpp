@@ -0,0 +1,106 @@
+#include <catch2/catch_all.hpp>
+#include "memoized_getter.hpp"
+#include "sync.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    constexpr std::size_t reads_per_write = 1 << 10;
+
+    // A getter worth memoizing: formats a reading with its unit, allocating the result.
+    struct format_celsius {
+        std::string operator()(const double&value) const {
+            return std::to_string(value) + " °C";
+        }
+    };
+
+    // Each write followed by reads_per_write reads, as on a configuration or display value.
+    template<typename Attr>
+    std::size_t read_heavy(Attr&attr, double next) {
+        attr = next;
+        std::size_t length = 0;
+        for (std::size_t i = 0; i < reads_per_write; ++i) {
+            length += attr->size();
+        }
+        return length;
+    }
+
+    // A write followed by `readers` threads each reading reads_per_thread times, as when a
+    // configuration push reaches a service. Recomputing getters run once per read; the
+    // single-flight one runs once in total.
+    constexpr std::size_t reads_per_thread = 16;
+
+    template<typename Attr>
+    std::size_t read_burst(Attr&attr, double next, unsigned readers) {
+        attr = next;
+        std::vector<std::size_t> lengths(readers);
+        std::vector<std::thread> threads;
+        for (unsigned i = 0; i < readers; ++i) {
+            threads.emplace_back([&attr, &lengths, i] {
+                for (std::size_t n = 0; n < reads_per_thread; ++n) {
+                    lengths[i] += attr.get().size();
+                }
+            });
+        }
+        for (auto&thread : threads) {
+            thread.join();
+        }
+        std::size_t length = 0;
+        for (std::size_t value : lengths) {
+            length += value;
+        }
+        return length;
+    }
+
+    std::vector<unsigned> thread_counts() {
+        std::vector<unsigned> counts;
+        const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned count = 1; count < cores; count *= 2) {
+            counts.push_back(count);
+        }
+        counts.push_back(cores);
+        return counts;
+    }
+
+    // Writes that are never read, where only the eager policy pays for the getter.
+    template<typename Attr>
+    std::size_t write_only(Attr&attr, double next) {
+        for (std::size_t i = 0; i < reads_per_write; ++i) {
+            attr = next + static_cast<double>(i);
+        }
+        return reads_per_write;
+    }
+}
+
+TEST_CASE("memoized getters versus recomputing on every read", "[benchmark][memoized]") {
+    touka::attr_impl<double, format_celsius> plain(0.0);
+    touka::attr_impl<double, touka::memoized_getter<double, format_celsius>> lazy(0.0);
+    touka::attr_impl<double, touka::memoized_getter<double, format_celsius, touka::memoize::eager>> eager(0.0);
+    double next = 0.0;
+
+    BENCHMARK("1 write, 1024 reads: getter") { return read_heavy(plain, next += 1.0); };
+    BENCHMARK("1 write, 1024 reads: memoized lazy") { return read_heavy(lazy, next += 1.0); };
+    BENCHMARK("1 write, 1024 reads: memoized eager") { return read_heavy(eager, next += 1.0); };
+
+    BENCHMARK("1024 writes: getter") { return write_only(plain, next += 1.0); };
+    BENCHMARK("1024 writes: memoized lazy") { return write_only(lazy, next += 1.0); };
+    BENCHMARK("1024 writes: memoized eager") { return write_only(eager, next += 1.0); };
+}
+
+TEST_CASE("single-flight memoized getter versus recomputing readers", "[benchmark][memoized]") {
+    using shared = touka::sync::shared_mutex;
+    touka::attr_impl<double, format_celsius, touka::default_setter<double>, shared> plain(0.0);
+    touka::attr_impl<double, touka::concurrent_memoized_getter<double, format_celsius>, touka::default_setter<double>,
+        shared> single_flight(0.0);
+    double next = 0.0;
+
+    for (unsigned readers : thread_counts()) {
+        const std::string suffix = " (" + std::to_string(readers) + " threads)";
+        BENCHMARK("read burst: getter" + suffix) { return read_burst(plain, next += 1.0, readers); };
+        BENCHMARK("read burst: single-flight" + suffix) { return read_burst(single_flight, next += 1.0, readers); };
+    }
+}
@@ -0,0 +1,98 @@
+#include <catch2/catch_all.hpp>
+#include "seqlock_attr.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    // 64 bytes: too large for a lock-free std::atomic.
+    struct pose {
+        double position[3];
+        double orientation[4];
+        long long timestamp;
+    };
+
+    constexpr std::size_t reads_per_thread = 1 << 16;
+
+    template<typename Mutex, typename ReadLock>
+    class locked_pose {
+    public:
+        pose load() const {
+            ReadLock lock(_mutex);
+            return _value;
+        }
+
+        void set(const pose&value) {
+            std::unique_lock lock(_mutex);
+            _value = value;
+        }
+
+    private:
+        mutable Mutex _mutex;
+        pose _value{};
+    };
+
+    // Wall time for `readers` threads to each complete reads_per_thread loads while one
+    // writer keeps publishing. Flat timings as the reader count grows mean linear scaling.
+    template<typename Shared>
+    double contended_reads(Shared&shared, unsigned readers) {
+        std::atomic<bool> stop{false};
+        std::thread writer([&] {
+            pose value{};
+            while (!stop.load(std::memory_order_relaxed)) {
+                value.timestamp++;
+                shared.set(value);
+                std::this_thread::yield();
+            }
+        });
+
+        std::vector<std::thread> threads;
+        std::atomic<long long> sink{0};
+        for (unsigned i = 0; i < readers; ++i) {
+            threads.emplace_back([&] {
+                long long sum = 0;
+                for (std::size_t n = 0; n < reads_per_thread; ++n) {
+                    sum += shared.load().timestamp;
+                }
+                sink.fetch_add(sum, std::memory_order_relaxed);
+            });
+        }
+        for (auto&thread : threads) {
+            thread.join();
+        }
+        stop = true;
+        writer.join();
+        return static_cast<double>(sink.load());
+    }
+
+    std::vector<unsigned> reader_counts() {
+        std::vector<unsigned> counts;
+        const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned count = 1; count < cores; count *= 2) {
+            counts.push_back(count);
+        }
+        counts.push_back(cores);
+        return counts;
+    }
+}
+
+TEST_CASE("reader scaling of seqlock_attr versus locks", "[benchmark][seqlock]") {
+    for (unsigned readers : reader_counts()) {
+        const std::string suffix = " (" + std::to_string(readers) + " readers)";
+
+        touka::seqlock_attr<pose> seqlock;
+        BENCHMARK("seqlock_attr<pose>" + suffix) { return contended_reads(seqlock, readers); };
+
+        locked_pose<std::mutex, std::unique_lock<std::mutex>> mutex;
+        BENCHMARK("std::mutex" + suffix) { return contended_reads(mutex, readers); };
+
+        locked_pose<std::shared_mutex, std::shared_lock<std::shared_mutex>> shared_mutex;
+        BENCHMARK("std::shared_mutex" + suffix) { return contended_reads(shared_mutex, readers); };
+    }
+}
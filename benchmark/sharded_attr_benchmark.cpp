@@ -0,0 +1,54 @@
+#include <catch2/catch_all.hpp>
+#include "sharded_attr.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    constexpr std::size_t increments_per_thread = 1 << 18;
+
+    // Wall time for `writers` threads to each complete increments_per_thread increments.
+    // Flat timings as the thread count grows mean linear scaling.
+    template<typename Counter>
+    std::uint64_t contended_increments(Counter&counter, unsigned writers) {
+        std::vector<std::thread> threads;
+        for (unsigned i = 0; i < writers; ++i) {
+            threads.emplace_back([&] {
+                for (std::size_t n = 0; n < increments_per_thread; ++n) {
+                    ++counter;
+                }
+            });
+        }
+        for (auto&thread : threads) {
+            thread.join();
+        }
+        return counter;
+    }
+
+    std::vector<unsigned> thread_counts() {
+        std::vector<unsigned> counts;
+        const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned count = 1; count < cores; count *= 2) {
+            counts.push_back(count);
+        }
+        counts.push_back(cores);
+        return counts;
+    }
+}
+
+TEST_CASE("increment scaling of sharded_attr versus std::atomic", "[benchmark][sharded]") {
+    for (unsigned writers : thread_counts()) {
+        const std::string suffix = " (" + std::to_string(writers) + " threads)";
+
+        std::atomic<std::uint64_t> atomic{0};
+        BENCHMARK("std::atomic<uint64_t>" + suffix) { return contended_increments(atomic, writers); };
+
+        touka::sharded_attr<std::uint64_t> sharded;
+        BENCHMARK("sharded_attr<uint64_t>" + suffix) { return contended_increments(sharded, writers); };
+    }
+}
@@ -0,0 +1,13 @@
+add_requires("catch2 3.x", { alias = "catch2" })
+
+target("benchmark")
+    set_kind("binary")
+    add_files("attr_benchmark.cpp", "seqlock_attr_benchmark.cpp", "sharded_attr_benchmark.cpp",
+              "futex_benchmark.cpp", "async_attr_benchmark.cpp",
+              "memoized_getter_benchmark.cpp")
+    add_packages("catch2")
+    add_deps("attr")
+    add_includedirs("../include/attr")
+    if is_plat("linux") then
+        add_syslinks("pthread")
+    end
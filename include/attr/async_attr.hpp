@@ -0,0 +1,420 @@
+#ifndef ASYNC_ATTR_HPP
+#define ASYNC_ATTR_HPP
+#include "attr.hpp"
+#include "function_ref.hpp"
+#include "futex.hpp"
+#include "seqlock_attr.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace touka {
+    // What a writer does when the dispatcher's queue is full.
+    enum class backpressure {
+        // Discard the change and count it in change_dispatcher::dropped().
+        drop,
+        // Wait for the consumer to make room.
+        block,
+        // Keep at most one change per attr in the queue; it delivers the latest value when
+        // it is consumed. An attr therefore never takes more than one cell, and only blocks
+        // if the queue is full of other attrs' changes.
+        coalesce,
+    };
+
+    // A change waiting to be delivered: the function that delivers it, the attr it came
+    // from and the new value itself, for values of up to payload_size bytes.
+    struct change_record {
+        static constexpr std::size_t payload_size = 16;
+
+        void (*deliver)(void*target, const unsigned char*payload) noexcept;
+        void*target;
+        alignas(std::uint64_t) unsigned char payload[payload_size];
+    };
+
+    namespace Internal {
+        // A bounded lock-free queue for many producers and a single consumer, after Dmitry
+        // Vyukov's bounded queue. Every cell carries a sequence number that tells producers
+        // whether the cell is free for their ticket, and the consumer whether the record in
+        // it has been published. Producers contend only on the tail ticket.
+        template<typename T>
+            requires std::is_trivially_copyable_v<T>
+        class mpsc_ring {
+        public:
+            explicit mpsc_ring(std::size_t capacity)
+                : _mask(std::bit_ceil(std::max<std::size_t>(capacity, 2)) - 1),
+                  _cells(std::make_unique<cell[]>(_mask + 1)) {
+                for (std::size_t i = 0; i <= _mask; ++i) {
+                    _cells[i].sequence.store(i, std::memory_order_relaxed);
+                }
+            }
+
+            mpsc_ring(const mpsc_ring&) = delete;
+            mpsc_ring& operator=(const mpsc_ring&) = delete;
+
+            // Returns false when the queue is full.
+            bool try_push(const T&value) noexcept {
+                std::size_t ticket = _tail.load(std::memory_order_relaxed);
+                for (;;) {
+                    cell&slot = _cells[ticket & _mask];
+                    const std::size_t sequence = slot.sequence.load(std::memory_order_acquire);
+                    const auto lag = static_cast<std::ptrdiff_t>(sequence - ticket);
+                    if (lag == 0) {
+                        if (_tail.compare_exchange_weak(ticket, ticket + 1, std::memory_order_relaxed)) {
+                            slot.value = value;
+                            slot.sequence.store(ticket + 1, std::memory_order_release);
+                            return true;
+                        }
+                    } else if (lag < 0) {
+                        // The consumer has not yet freed the cell from the previous lap.
+                        return false;
+                    } else {
+                        ticket = _tail.load(std::memory_order_relaxed);
+                    }
+                }
+            }
+
+            // Consumer only. Returns false when the next record is not published yet.
+            bool try_pop(T&value) noexcept {
+                cell&slot = _cells[_head & _mask];
+                if (slot.sequence.load(std::memory_order_acquire) != _head + 1) {
+                    return false;
+                }
+                value = slot.value;
+                slot.sequence.store(_head + _mask + 1, std::memory_order_release);
+                ++_head;
+                return true;
+            }
+
+            // Consumer only.
+            bool ready() const noexcept {
+                return _cells[_head & _mask].sequence.load(std::memory_order_acquire) == _head + 1;
+            }
+
+            // Tickets handed out to producers so far.
+            std::size_t tickets() const noexcept { return _tail.load(std::memory_order_acquire); }
+
+            std::size_t capacity() const noexcept { return _mask + 1; }
+
+        private:
+            struct cell {
+                std::atomic<std::size_t> sequence;
+                T value;
+            };
+
+            const std::size_t _mask;
+            std::unique_ptr<cell[]> _cells;
+            alignas(64) std::atomic<std::size_t> _tail{0};
+            alignas(64) std::size_t _head = 0;
+        };
+    } // namespace Internal
+
+    // Moves the side effects of writes off the writer's thread. Writers post compact change
+    // records into a bounded lock-free queue; a single consumer delivers them in order,
+    // either on a thread the dispatcher owns or through drains submitted to an executor.
+    // A post costs the writer one ticket and, only when the consumer has gone idle, one
+    // wake-up.
+    //
+    // Handlers run on the consumer and must not throw. A handler that writes an async_attr
+    // with backpressure::block can deadlock once the queue is full.
+    class change_dispatcher {
+    public:
+        using executor_type = std::function<void(std::function<void()>)>;
+
+        // Delivers on a thread of its own, which sleeps while there is nothing to deliver.
+        explicit change_dispatcher(std::size_t capacity = 1024)
+            : _ring(capacity), _worker([this] { _work(); }) {
+        }
+
+        // Submits drains to executor, such as a thread pool's submit function. A drain is only
+        // submitted when none is pending, and drains never deliver concurrently, so records
+        // are still delivered in order.
+        change_dispatcher(std::size_t capacity, executor_type executor)
+            : _ring(capacity), _executor(std::move(executor)) {
+        }
+
+        change_dispatcher(const change_dispatcher&) = delete;
+        change_dispatcher& operator=(const change_dispatcher&) = delete;
+
+        // Delivers what was already posted. Nothing may post concurrently.
+        ~change_dispatcher() {
+            if (_worker.joinable()) {
+                _stopping.store(true, std::memory_order_seq_cst);
+                _scheduled.store(1, std::memory_order_seq_cst);
+                Internal::futex_wake_one(&_scheduled);
+                _worker.join();
+            } else {
+                flush();
+                while (_in_flight.load(std::memory_order_acquire) != 0) {
+                    std::this_thread::yield();
+                }
+            }
+        }
+
+        // Queues record, applying policy if the queue is full. Returns false if it was dropped.
+        bool post(const change_record&record, backpressure policy) {
+            if (!_ring.try_push(record)) [[unlikely]] {
+                if (policy == backpressure::drop) {
+                    _dropped.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+                // The predicate retries the push every time the consumer makes progress.
+                Internal::futex_wait_while(_delivered, _waiters, [&] { return !_ring.try_push(record); });
+            }
+            // Pairs with the fence in _drain(): either the consumer sees this record, or this
+            // writer sees that no drain is scheduled and schedules one.
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (_scheduled.load(std::memory_order_relaxed) == 0 &&
+                _scheduled.exchange(1, std::memory_order_acq_rel) == 0) {
+                _schedule();
+            }
+            return true;
+        }
+
+        // Waits until every record posted before the call has been delivered. Never call
+        // from a handler.
+        void flush() {
+            const auto target = static_cast<std::uint32_t>(_ring.tickets());
+            Internal::futex_wait_while(_delivered, _waiters, [&] {
+                return static_cast<std::int32_t>(target - _delivered.load(std::memory_order_acquire)) > 0;
+            });
+        }
+
+        std::uint64_t dropped() const noexcept { return _dropped.load(std::memory_order_relaxed); }
+
+        std::size_t capacity() const noexcept { return _ring.capacity(); }
+
+    private:
+        void _schedule() {
+            if (!_executor) {
+                Internal::futex_wake_one(&_scheduled);
+                return;
+            }
+            _in_flight.fetch_add(1, std::memory_order_relaxed);
+            try {
+                _executor([this] {
+                    _drain();
+                    // Last access: the destructor may run as soon as this is observed.
+                    _in_flight.fetch_sub(1, std::memory_order_release);
+                });
+            } catch (...) {
+                _in_flight.fetch_sub(1, std::memory_order_release);
+                _scheduled.store(0, std::memory_order_seq_cst);
+                throw;
+            }
+        }
+
+        void _work() {
+            for (;;) {
+                while (_scheduled.load(std::memory_order_acquire) == 0) {
+                    Internal::futex_wait(&_scheduled, 0);
+                }
+                _drain();
+                if (_stopping.load(std::memory_order_acquire)) {
+                    return;
+                }
+            }
+        }
+
+        // A drain submitted to an executor can start while the one before it is between its
+        // last pop and returning, so the consumer side of the ring is only used under
+        // _drain_mutex. The later drain waits at most for that check, then delivers whatever
+        // the earlier one left.
+        void _drain() {
+            std::lock_guard lock(_drain_mutex);
+            for (;;) {
+                change_record record;
+                while (_ring.try_pop(record)) {
+                    record.deliver(record.target, record.payload);
+                    _delivered.fetch_add(1, std::memory_order_seq_cst);
+                    Internal::futex_wake_waiters(_delivered, _waiters);
+                }
+                _scheduled.store(0, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                // A record published after the last pop may have found the drain still scheduled.
+                if (!_ring.ready() || _scheduled.exchange(1, std::memory_order_acq_rel) != 0) {
+                    return;
+                }
+            }
+        }
+
+        Internal::mpsc_ring<change_record> _ring;
+        executor_type _executor;
+        std::mutex _drain_mutex;
+        alignas(64) std::atomic<std::uint32_t> _scheduled{0};
+        std::atomic<std::uint32_t> _delivered{0};
+        std::atomic<std::uint32_t> _waiters{0};
+        std::atomic<std::uint32_t> _in_flight{0};
+        std::atomic<bool> _stopping{false};
+        std::atomic<std::uint64_t> _dropped{0};
+        std::thread _worker;
+    };
+
+    // An attr whose change handler runs on a change_dispatcher instead of inside the write.
+    // Every write that changes what get() returns posts a change record carrying the new
+    // getter result, so the handler never reads the attr itself and the writer never waits
+    // for the handler. Results must be small, trivially copyable values.
+    //
+    // Like attr_impl, one thread writes at a time. Destroying an async_attr that has posted
+    // waits for the dispatcher to deliver what is queued.
+    template<typename T, typename Getter = default_getter<T>, typename Setter = default_setter<T>>
+        requires GetterFn<Getter, T> && SetterFn<Setter, T> &&
+                 std::is_trivially_copyable_v<std::remove_cvref_t<getter_result_t<Getter, T>>> &&
+                 std::default_initializable<std::remove_cvref_t<getter_result_t<Getter, T>>> &&
+                 (sizeof(std::remove_cvref_t<getter_result_t<Getter, T>>) <= change_record::payload_size) &&
+                 (alignof(std::remove_cvref_t<getter_result_t<Getter, T>>) <= alignof(std::uint64_t))
+    class async_attr {
+    public:
+        using attr_type = attr_impl<T, Getter, Setter>;
+        using value_type = T;
+        using result_type = std::remove_cvref_t<getter_result_t<Getter, T>>;
+        using handler_type = function_ref<void(const result_type&)>;
+
+        async_attr(change_dispatcher&dispatcher, handler_type handler, backpressure policy = backpressure::block)
+            : _dispatcher(&dispatcher), _handler(handler), _policy(policy) {
+        }
+
+        async_attr(change_dispatcher&dispatcher, handler_type handler, backpressure policy, const T&value)
+            : _attr(value), _dispatcher(&dispatcher), _handler(handler), _policy(policy) {
+        }
+
+        // Queued records refer to this object, so it is neither copied nor moved.
+        async_attr(const async_attr&) = delete;
+        async_attr& operator=(const async_attr&) = delete;
+
+        ~async_attr() {
+            if (_posted) {
+                _dispatcher->flush();
+            }
+        }
+
+        decltype(auto) get() const { return _attr.get(); }
+
+        decltype(auto) operator*() const { return get(); }
+
+        auto operator->() const { return _attr.operator->(); }
+
+        operator T() const requires std::convertible_to<getter_result_t<Getter, T>, T> { return get(); }
+
+        auto operator<=>(const T&value) const { return _attr <=> value; }
+
+        bool operator==(const T&value) const { return _attr == value; }
+
+        template<typename U>
+            requires (!std::same_as<std::remove_cvref_t<U>, async_attr>) && std::is_assignable_v<attr_type&, U>
+        async_attr& operator=(U&&value) {
+            _write([&](attr_type&attr) { attr = std::forward<U>(value); });
+            return *this;
+        }
+
+        template<typename... Args>
+            requires std::constructible_from<std::remove_cv_t<T>, Args...>
+        void emplace(Args&&... args) {
+            _write([&](attr_type&attr) { attr.emplace(std::forward<Args>(args)...); });
+        }
+
+        template<typename F>
+            requires std::invocable<F, std::remove_cv_t<T>&>
+        void modify(F&&fn) {
+            _write([&](attr_type&attr) { attr.modify(std::forward<F>(fn)); });
+        }
+
+#define ATTR_ASYNC_COMPOUND_ASSIGNMENT(op)                                                    \
+        template<typename U>                                                                  \
+            requires requires(attr_type& attr, U&& rhs) { attr op std::forward<U>(rhs); }     \
+        async_attr& operator op(U&&rhs) {                                                     \
+            _write([&](attr_type& attr) { attr op std::forward<U>(rhs); });                   \
+            return *this;                                                                     \
+        }
+
+        ATTR_ASYNC_COMPOUND_ASSIGNMENT(+=)
+        ATTR_ASYNC_COMPOUND_ASSIGNMENT(-=)
+        ATTR_ASYNC_COMPOUND_ASSIGNMENT(*=)
+        ATTR_ASYNC_COMPOUND_ASSIGNMENT(/=)
+        ATTR_ASYNC_COMPOUND_ASSIGNMENT(%=)
+        ATTR_ASYNC_COMPOUND_ASSIGNMENT(&=)
+        ATTR_ASYNC_COMPOUND_ASSIGNMENT(|=)
+        ATTR_ASYNC_COMPOUND_ASSIGNMENT(^=)
+        ATTR_ASYNC_COMPOUND_ASSIGNMENT(<<=)
+        ATTR_ASYNC_COMPOUND_ASSIGNMENT(>>=)
+#undef ATTR_ASYNC_COMPOUND_ASSIGNMENT
+
+        async_attr& operator++() requires requires(attr_type&attr) { ++attr; } {
+            _write([](attr_type&attr) { ++attr; });
+            return *this;
+        }
+
+        async_attr& operator--() requires requires(attr_type&attr) { --attr; } {
+            _write([](attr_type&attr) { --attr; });
+            return *this;
+        }
+
+    private:
+        // Runs write on the underlying attr and posts the new result if it changed.
+        template<typename Write>
+        void _write(Write&&write) {
+            if constexpr (std::equality_comparable<result_type>) {
+                const result_type previous(_attr.get());
+                write(_attr);
+                if (previous == _attr.get()) {
+                    return;
+                }
+            } else {
+                write(_attr);
+            }
+            _post(_attr.get());
+        }
+
+        void _post(const result_type&value) {
+            _posted = true;
+            change_record record;
+            record.target = this;
+            if (_policy == backpressure::coalesce) {
+                _latest.set(value);
+                // Acquire-release pairs with the exchange in _deliver_latest().
+                if (_queued.exchange(true, std::memory_order_acq_rel)) {
+                    return;
+                }
+                record.deliver = &_deliver_latest;
+                _dispatcher->post(record, backpressure::block);
+            } else {
+                record.deliver = &_deliver;
+                std::memcpy(record.payload, std::addressof(value), sizeof(result_type));
+                _dispatcher->post(record, _policy);
+            }
+        }
+
+        static void _deliver(void*target, const unsigned char*payload) noexcept {
+            const auto&self = *static_cast<const async_attr *>(target);
+            self._handler(*std::launder(reinterpret_cast<const result_type *>(payload)));
+        }
+
+        static void _deliver_latest(void*target, const unsigned char*) noexcept {
+            auto&self = *static_cast<async_attr *>(target);
+            // Cleared before reading, so a write after the read queues a fresh record.
+            self._queued.exchange(false, std::memory_order_acq_rel);
+            self._handler(self._latest.load());
+        }
+
+        attr_type _attr{};
+        change_dispatcher*_dispatcher;
+        handler_type _handler;
+        backpressure _policy;
+        bool _posted = false;
+        std::atomic<bool> _queued{false};
+        seqlock_attr<result_type> _latest;
+    };
+}
+
+#endif //ASYNC_ATTR_HPP
@@ -0,0 +1,241 @@
+#ifndef ATOMIC_ATTR_HPP
+#define ATOMIC_ATTR_HPP
+#include "attr.hpp"
+#include "futex.hpp"
+
+#include <atomic>
+#include <bit>
+#include <concepts>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace touka {
+    namespace Internal {
+        // compare_exchange failure orders may not release.
+        constexpr std::memory_order failure_order(std::memory_order order) noexcept {
+            switch (order) {
+                case std::memory_order_acq_rel:
+                    return std::memory_order_acquire;
+                case std::memory_order_release:
+                    return std::memory_order_relaxed;
+                default:
+                    return order;
+            }
+        }
+
+        template<typename Atomic>
+        inline constexpr bool is_atomic_ref_v = false;
+
+        template<typename T>
+        inline constexpr bool is_atomic_ref_v<std::atomic_ref<T>> = true;
+    } // namespace Internal
+
+    // An attr whose value lives in a std::atomic (or, through atomic_ref_attr, in existing
+    // memory viewed by a std::atomic_ref). Reads run the getter on an atomically loaded
+    // copy; writes run the setter on a private copy inside a compare-exchange loop, so
+    // clamping or validating setters stay correct under contention. With default_setter,
+    // plain stores and fetch_* operations are used instead of the loop.
+    template<typename Atomic, typename Getter, typename Setter>
+        requires GetterFn<Getter, typename Atomic::value_type> && SetterFn<Setter, typename Atomic::value_type>
+    class basic_atomic_attr {
+    public:
+        using value_type = typename Atomic::value_type;
+        using GetterType = Getter;
+        using SetterType = Setter;
+        using result_type = std::remove_cvref_t<getter_result_t<Getter, value_type>>;
+
+        static_assert(Atomic::is_always_lock_free, "atomic attr requires a lock-free value_type");
+
+        // True when the value is held by reference to existing memory.
+        static constexpr bool wraps_existing = Internal::is_atomic_ref_v<Atomic>;
+
+        constexpr basic_atomic_attr() noexcept requires (!wraps_existing) : _value() {
+        }
+
+        explicit constexpr basic_atomic_attr(value_type desired) noexcept requires (!wraps_existing)
+            : _value(desired) {
+        }
+
+        // The referenced object must outlive the attr and be aligned to
+        // std::atomic_ref<value_type>::required_alignment.
+        explicit basic_atomic_attr(value_type&target) noexcept requires wraps_existing : _value(target) {
+        }
+
+        basic_atomic_attr(const basic_atomic_attr&) = delete;
+        basic_atomic_attr& operator=(const basic_atomic_attr&) = delete;
+
+        value_type load(std::memory_order order = std::memory_order_seq_cst) const noexcept {
+            return _value.load(order);
+        }
+
+        // Returns by value: the getter runs on a loaded copy, never on the shared storage.
+        result_type get(std::memory_order order = std::memory_order_seq_cst) const {
+            return std::invoke(_getter, load(order));
+        }
+
+        operator value_type() const requires std::convertible_to<result_type, value_type> { return get(); }
+
+        void set(const value_type&new_value, std::memory_order order = std::memory_order_seq_cst) {
+            if constexpr (std::same_as<Setter, default_setter<value_type>>) {
+                _value.store(new_value, order);
+            } else {
+                _update([&](value_type&desired, const value_type&) {
+                    std::invoke(_setter, desired, new_value);
+                }, order);
+            }
+        }
+
+        basic_atomic_attr& operator=(const value_type&new_value) {
+            set(new_value);
+            return *this;
+        }
+
+        // Applies fn to a copy of the current value and publishes it, retrying if another
+        // writer got in first; fn may therefore run more than once. See
+        // Internal::modify_copy() for how the setter sees the result. Returns the value
+        // published.
+        template<typename F>
+            requires std::invocable<F&, value_type&>
+        value_type modify(F&&fn, std::memory_order order = std::memory_order_seq_cst) {
+            return _modify(fn, order).second;
+        }
+
+        // Values whose atomic has the matching fetch_* operation (integers for all of them,
+        // pointers for + and -, but not bool) map onto it when the setter is the default;
+        // everything else goes through modify().
+        template<typename U>
+        value_type operator+=(const U&rhs) requires requires(value_type&value, const U&r) { value += r; } {
+            if constexpr (has_fetch_ops && requires { _value.fetch_add(rhs); }) {
+                return _value.fetch_add(rhs) + rhs;
+            } else {
+                return modify([&](value_type&value) { value += rhs; });
+            }
+        }
+
+        template<typename U>
+        value_type operator-=(const U&rhs) requires requires(value_type&value, const U&r) { value -= r; } {
+            if constexpr (has_fetch_ops && requires { _value.fetch_sub(rhs); }) {
+                return _value.fetch_sub(rhs) - rhs;
+            } else {
+                return modify([&](value_type&value) { value -= rhs; });
+            }
+        }
+
+        value_type operator&=(const value_type&rhs) requires requires(value_type&value) { value &= value; } {
+            if constexpr (has_fetch_ops && requires { _value.fetch_and(rhs); }) {
+                return _value.fetch_and(rhs) & rhs;
+            } else {
+                return modify([&](value_type&value) { value &= rhs; });
+            }
+        }
+
+        value_type operator|=(const value_type&rhs) requires requires(value_type&value) { value |= value; } {
+            if constexpr (has_fetch_ops && requires { _value.fetch_or(rhs); }) {
+                return _value.fetch_or(rhs) | rhs;
+            } else {
+                return modify([&](value_type&value) { value |= rhs; });
+            }
+        }
+
+        value_type operator^=(const value_type&rhs) requires requires(value_type&value) { value ^= value; } {
+            if constexpr (has_fetch_ops && requires { _value.fetch_xor(rhs); }) {
+                return _value.fetch_xor(rhs) ^ rhs;
+            } else {
+                return modify([&](value_type&value) { value ^= rhs; });
+            }
+        }
+
+        value_type operator++() requires requires(value_type&value) { ++value; } { return *this += 1; }
+
+        value_type operator--() requires requires(value_type&value) { --value; } { return *this -= 1; }
+
+        value_type operator++(int) requires requires(value_type&value) { ++value; } {
+            if constexpr (has_fetch_ops) {
+                return _value.fetch_add(1);
+            } else {
+                return _modify([](value_type&value) { ++value; }, std::memory_order_seq_cst).first;
+            }
+        }
+
+        value_type operator--(int) requires requires(value_type&value) { --value; } {
+            if constexpr (has_fetch_ops) {
+                return _value.fetch_sub(1);
+            } else {
+                return _modify([](value_type&value) { --value; }, std::memory_order_seq_cst).first;
+            }
+        }
+
+        // Blocks until the value differs from old, like std::atomic::wait: writers do not wake
+        // waiters by themselves, call notify_one() or notify_all() after the write. Owned
+        // 32-bit values wait on a futex over the atomic itself; other values use
+        // std::atomic::wait.
+        void wait(value_type old, std::memory_order order = std::memory_order_seq_cst) const noexcept {
+            if constexpr (uses_futex) {
+                const auto expected = std::bit_cast<std::uint32_t>(old);
+                while (std::bit_cast<std::uint32_t>(_value.load(order)) == expected) {
+                    Internal::futex_wait(std::addressof(_value), expected);
+                }
+            } else {
+                _value.wait(old, order);
+            }
+        }
+
+        void notify_one() noexcept {
+            if constexpr (uses_futex) {
+                Internal::futex_wake_one(std::addressof(_value));
+            } else {
+                _value.notify_one();
+            }
+        }
+
+        void notify_all() noexcept {
+            if constexpr (uses_futex) {
+                Internal::futex_wake_all(std::addressof(_value));
+            } else {
+                _value.notify_all();
+            }
+        }
+
+    private:
+        static constexpr bool uses_futex = !wraps_existing && sizeof(value_type) == sizeof(std::uint32_t) &&
+                                           sizeof(Atomic) == sizeof(std::uint32_t);
+
+        static constexpr bool has_fetch_ops = std::same_as<Setter, default_setter<value_type>> &&
+                                              (std::integral<value_type> || std::is_pointer_v<value_type>);
+
+        template<typename F>
+        std::pair<value_type, value_type> _modify(F&&fn, std::memory_order order) {
+            return _update([&](value_type&desired, const value_type&) {
+                Internal::modify_copy(_setter, desired, fn);
+            }, order);
+        }
+
+        // Runs apply(desired, current) on a copy of the current value until the
+        // compare-exchange succeeds; returns the previous and the published value.
+        template<typename Apply>
+        std::pair<value_type, value_type> _update(Apply&&apply, std::memory_order order) {
+            value_type current = _value.load(std::memory_order_relaxed);
+            value_type desired = current;
+            do {
+                desired = current;
+                apply(desired, std::as_const(current));
+            } while (!_value.compare_exchange_weak(current, desired, order, Internal::failure_order(order)));
+            return {current, desired};
+        }
+
+        Atomic _value;
+        ATTR_NO_UNIQUE_ADDRESS Getter _getter{};
+        ATTR_NO_UNIQUE_ADDRESS Setter _setter{};
+    };
+
+    template<typename T, typename Getter = default_getter<T>, typename Setter = default_setter<T>>
+    using atomic_attr = basic_atomic_attr<std::atomic<T>, Getter, Setter>;
+
+    template<typename T, typename Getter = default_getter<T>, typename Setter = default_setter<T>>
+    using atomic_ref_attr = basic_atomic_attr<std::atomic_ref<T>, Getter, Setter>;
+}
+
+#endif //ATOMIC_ATTR_HPP
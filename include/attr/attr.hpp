@@ -4,64 +4,289 @@
 
 #ifndef ATTR_HPP
 #define ATTR_HPP
+#include <compare>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <functional>
 #include <initializer_list>
+#include <memory>
+#include <new>
 #include <type_traits>
+#include <utility>
+
+// Lets stateless hooks share an address with the stored value, so an attr with
+// empty getter/setter types has the same size and alignment as its value_type.
+#if defined(_MSC_VER) && !defined(__clang__)
+#define ATTR_NO_UNIQUE_ADDRESS [[msvc::no_unique_address]]
+#else
+#define ATTR_NO_UNIQUE_ADDRESS [[no_unique_address]]
+#endif
 
 namespace touka {
+    // A getter is any hook callable with the stored value; it may return a copy,
+    // a reference into the storage, or a proxy/view type.
+    template<typename Fn, typename T>
+    concept GetterFn = std::invocable<const Fn&, const T&>;
+
+    template<typename Fn, typename T>
+    using getter_result_t = std::invoke_result_t<const Fn&, const T&>;
+
+    // Getters returning an lvalue reference let attr_impl::get() hand out const T& without copying.
+    template<typename Fn, typename T>
+    concept ReferenceGetterFn = GetterFn<Fn, T> && std::is_lvalue_reference_v<getter_result_t<Fn, T>>;
+
+    // Getters exposing `after_write(const T&)` are called after every write with the new
+    // value, so that they can cache what they compute from it (see memoized_getter.hpp).
     template<typename Fn, typename T>
-    concept GetterFn = requires(Fn&&fn, T&&value)
+    concept WriteHookGetterFn = GetterFn<Fn, T> && requires(const Fn&fn, const T&value)
     {
-        { std::invoke(std::forward<Fn>(fn), std::forward<T>(value)) } -> std::convertible_to<T>;
+        fn.after_write(value);
     };
 
+    // Write-hook getters may also expose a noexcept `after_moved_from(const T&)`, called
+    // instead of after_write() when the value is moved out of the attr, so that they can drop
+    // what they cached without computing anything from the moved-from value.
+    template<typename Fn, typename T>
+    concept MovedFromHookGetterFn = WriteHookGetterFn<Fn, T> && requires(const Fn&fn, const T&value)
+    {
+        { fn.after_moved_from(value) } noexcept;
+    };
+
+    // Setters receive the stored value and the incoming one. Overloading on T&& lets a
+    // setter steal from rvalues; setters taking only const T& still accept them.
     template<typename Fn, typename T>
     concept SetterFn = requires(Fn&&fn, T&&value, T&&new_value)
     {
         { std::invoke(std::forward<Fn>(fn), value, new_value) };
     };
 
+    // Setters that validate or normalise values opt into running on construction by
+    // declaring `static constexpr bool runs_on_construction = true;`. Other setters are
+    // bypassed when an attr is constructed, and copies are built directly in place.
+    template<typename Fn>
+    concept ConstructionSetterFn = requires { requires Fn::runs_on_construction; };
+
+    // Setters exposing `after_modify(T&)` let attr_impl::modify() mutate the stored value in
+    // place and then re-validate it, instead of copying it out and setting it back.
+    template<typename Fn, typename T>
+    concept ModifyHookFn = requires(const Fn&fn, T&value)
+    {
+        fn.after_modify(value);
+    };
+
+    namespace Internal {
+        // Stands in for the operations passed to Setter::update(): lambdas that capture the
+        // operand, so a setter that only takes a function pointer does not qualify.
+        template<typename T>
+        struct update_op_archetype {
+            void*captured;
+
+            void operator()(T&) const;
+        };
+    } // namespace Internal
+
+    // Setters exposing `update(T& value, Op op)` take over compound assignment and increments:
+    // `op` applies the operation to a T&, and the setter decides how and where to run it. Op
+    // is a callable holding state, so update() must accept any such callable (a template
+    // parameter, or a type-erased wrapper like std::function).
+    template<typename Fn, typename T>
+    concept UpdateFn = requires(const Fn&fn, T&value, Internal::update_op_archetype<T>&op)
+    {
+        fn.update(value, op);
+    };
+
     template<typename value_type>
     struct default_getter {
-        inline decltype(auto) operator()(value_type&& val) const & {
-            return std::forward<value_type>(val);
-        }
-        inline decltype(auto) operator()(value_type&& val) & {
-            return std::forward<value_type>(val);
-        }
-        inline decltype(auto) operator()(value_type&& val) && {
-            return std::forward<value_type>(val);
-        }
-        inline decltype(auto) operator()(value_type&& val) const && {
-            return std::forward<value_type>(val);
-        }
-        inline decltype(auto) operator()(const value_type& val) const {
-            return val;
-        }
-        inline decltype(auto) operator()(value_type& val) const {
+        constexpr const value_type& operator()(const value_type& val) const noexcept {
             return val;
         }
     };
 
     template<typename value_type>
     struct default_setter {
-        inline void operator()(value_type&value, value_type& new_value) const  {
-            value = new_value;
-        }
-        inline void operator()(value_type&value, const value_type&new_value) const  {
+        constexpr void operator()(value_type&value, const value_type&new_value) const  {
             value = new_value;
         }
-        inline void operator()(value_type&value, value_type&&new_value) const  {
+        constexpr void operator()(value_type&value, value_type&&new_value) const  {
             value = std::move(new_value);
         }
     };
 
+    namespace sync {
+        // The default synchronization policy: no locking and no storage. The policies in
+        // sync.hpp make an attr safe to share between threads.
+        struct none {
+        };
+    } // namespace sync
+
+    namespace Internal {
+        // Defined with the policies in sync.hpp.
+        template<typename T>
+        class atomic_words;
+
+        // Policies whose readers take no lock at all (sync::seqlock) declare
+        // `static constexpr bool publishes_value = true;`. The attr then keeps a copy of the
+        // value in atomic_words, stored under the writer's lock after every write, and
+        // readers load that copy through read() instead of racing with writes to the value.
+        template<typename Sync>
+        concept PublishingPolicy = requires { requires Sync::publishes_value; };
+
+        // Policies whose readers may run the getter at the same time as one another declare
+        // `static constexpr bool shares_readers = true;` (sync::shared_mutex, sync::seqlock).
+        template<typename Sync>
+        concept SharedReadPolicy = requires { requires Sync::shares_readers; };
+    } // namespace Internal
+
+    // Getters that keep state between calls without synchronizing it declare
+    // `static constexpr bool shared_reads = false;` and do not work under policies whose
+    // readers overlap. Getters that synchronize their readers but assume no write runs
+    // meanwhile declare `static constexpr bool unlocked_reads = false;` and do not work under
+    // policies whose readers take no lock. attr_impl rejects both combinations.
+    template<typename Fn, typename Sync>
+    concept ReadableUnderPolicy =
+            (!Internal::SharedReadPolicy<Sync> || !requires { requires !Fn::shared_reads; }) &&
+            (!Internal::PublishingPolicy<Sync> || !requires { requires !Fn::unlocked_reads; });
+
+    // Resumes a coroutine on the thread that completes what it awaited. The default
+    // executor of the awaitables returned by changed() and until().
+    struct inline_executor {
+        template<typename Handle>
+        void operator()(Handle handle) const { handle.resume(); }
+    };
+
     template<typename T,
         typename Getter = default_getter<T>,
-        typename Setter = default_setter<T>>
-    requires GetterFn<Getter, T> && SetterFn<Setter, T>
+        typename Setter = default_setter<T>,
+        typename Sync = sync::none>
+    requires GetterFn<Getter, T> && SetterFn<Setter, T> && ReadableUnderPolicy<Getter, Sync>
     class attr_impl;
 
     namespace Internal {
+        template<typename R>
+        struct arrow_proxy {
+            R value;
+
+            constexpr const R* operator->() const noexcept {
+                return std::addressof(value);
+            }
+        };
+
+        struct empty_slot {
+        };
+
+        // The predicate of changed(): any new value will do.
+        struct accept_any {
+            template<typename U>
+            constexpr bool operator()(const U&) const noexcept { return true; }
+        };
+
+        // Policies that only observe writes, such as sync::versioned<sync::none>, declare
+        // `static constexpr bool is_synchronized = false;` and keep the unlocked read path.
+        template<typename Sync>
+        concept SynchronizingPolicy = !std::same_as<Sync, sync::none> &&
+                                      !requires { requires !Sync::is_synchronized; };
+
+        // Holds a policy's exclusive (writer) side for the guard's lifetime.
+        template<typename Sync>
+        class sync_guard {
+        public:
+            constexpr explicit sync_guard(Sync&sync) : _sync(sync) { _sync.lock(); }
+            sync_guard(const sync_guard&) = delete;
+            sync_guard& operator=(const sync_guard&) = delete;
+            constexpr ~sync_guard() { _sync.unlock(); }
+
+        private:
+            Sync&_sync;
+        };
+
+        template<>
+        class sync_guard<sync::none> {
+        public:
+            constexpr explicit sync_guard(sync::none&) noexcept {
+            }
+        };
+
+        // Holds the writer sides of two policies, taken in the order given, as swap() needs.
+        // Policies that resume awaiting coroutines when unlocked (sync::versioned) resume
+        // them only once both are released, so that a coroutine resumed inline may use
+        // either attr.
+        template<typename Sync>
+        class sync_pair_guard {
+        public:
+            constexpr sync_pair_guard(Sync&first, Sync&second) : _first(first), _second(second) {
+                _first.lock();
+                try {
+                    _second.lock();
+                } catch (...) {
+                    _first.unlock();
+                    throw;
+                }
+            }
+
+            sync_pair_guard(const sync_pair_guard&) = delete;
+            sync_pair_guard& operator=(const sync_pair_guard&) = delete;
+
+            constexpr ~sync_pair_guard() {
+                if constexpr (requires { _first.unlock_deferring_resume(); _first.resume_awaiting(); }) {
+                    _second.unlock_deferring_resume();
+                    _first.unlock_deferring_resume();
+                    _first.resume_awaiting();
+                    _second.resume_awaiting();
+                } else {
+                    _second.unlock();
+                    _first.unlock();
+                }
+            }
+
+        private:
+            Sync&_first;
+            Sync&_second;
+        };
+
+        // Holds a policy's shared (reader) side for the guard's lifetime.
+        template<typename Sync>
+        class shared_sync_guard {
+        public:
+            explicit shared_sync_guard(Sync&sync) : _sync(sync) { _sync.lock_shared(); }
+            shared_sync_guard(const shared_sync_guard&) = delete;
+            shared_sync_guard& operator=(const shared_sync_guard&) = delete;
+            ~shared_sync_guard() { _sync.unlock_shared(); }
+
+        private:
+            Sync&_sync;
+        };
+
+        template<>
+        class shared_sync_guard<sync::none> {
+        public:
+            constexpr explicit shared_sync_guard(sync::none&) noexcept {
+            }
+        };
+
+        // modify() for attrs that write through a private copy and publish it afterwards
+        // (atomic_attr, seqlock_attr, rcu_attr): applies fn to copy and lets setter see the
+        // result the way attr_impl::modify() would. A setter with update() runs fn itself;
+        // default_setter leaves the change as it is; after_modify() re-validates the copy in
+        // place; any other setter receives the modified value as a new one.
+        template<typename T, typename Setter, typename F>
+        constexpr void modify_copy(Setter&setter, T&copy, F&fn) {
+            if constexpr (UpdateFn<Setter, T>) {
+                setter.update(copy, fn);
+            } else if constexpr (std::same_as<Setter, default_setter<T>>) {
+                std::invoke(fn, copy);
+            } else if constexpr (ModifyHookFn<Setter, T>) {
+                std::invoke(fn, copy);
+                setter.after_modify(copy);
+            } else {
+                T modified = copy;
+                std::invoke(fn, modified);
+                std::invoke(setter, copy, std::move(modified));
+            }
+        }
+
         template<typename T>
         concept TriviallyDestructible = std::is_trivially_destructible_v<T>;
 
@@ -134,8 +359,13 @@ namespace touka {
             !std::same_as<std::remove_cvref_t<U>, attr_impl<T>>;
 
 
-    template<typename T, typename Getter, typename Setter>
-    requires GetterFn<Getter, T> && SetterFn<Setter, T>
+    // Sync selects how concurrent access is serialized. With the default sync::none the
+    // attr is exactly as before: no lock, no extra storage, get() may return references.
+    // Any other policy guards every read and write, makes get() return by value (a
+    // reference could not outlive the lock), and makes swap and comparisons lock both
+    // attrs in address order so that pairs of attrs can never deadlock.
+    template<typename T, typename Getter, typename Setter, typename Sync>
+    requires GetterFn<Getter, T> && SetterFn<Setter, T> && ReadableUnderPolicy<Getter, Sync>
     class attr_impl : private Internal::attr_storage<std::remove_cv_t<T>> {
         using BaseType = Internal::attr_storage<std::remove_cv_t<T>>;
 
@@ -146,97 +376,439 @@ namespace touka {
         using value_result_type = std::remove_volatile_t<value_type>;
         using GetterType = std::type_identity_t<Getter>;
         using SetterType = std::type_identity_t<Setter>;
+        using SyncType = Sync;
+
+        using getter_result_type = getter_result_t<Getter, T>;
+
+        // True when neither hook carries state; such attrs occupy exactly sizeof(T).
+        static constexpr bool has_stateless_hooks = std::is_empty_v<Getter> && std::is_empty_v<Setter>;
+        // True when get() returns a reference instead of a copy of the value.
+        static constexpr bool has_reference_getter = ReferenceGetterFn<Getter, T>;
+        // True when constructors route the initial value through the setter.
+        static constexpr bool runs_setter_on_construction = ConstructionSetterFn<Setter>;
+        // True when accesses are guarded by a synchronization policy.
+        static constexpr bool is_synchronized = Internal::SynchronizingPolicy<Sync>;
+        // True when copies and moves may bypass the hooks entirely, which makes the attr
+        // trivially copyable: T is, the getter is, assignment uses default_setter and
+        // the policy has nothing to lock or count.
+        static constexpr bool has_trivial_copy = std::is_trivially_copyable_v<std::remove_cv_t<T>> &&
+                                                 std::is_trivially_copyable_v<Getter> &&
+                                                 std::same_as<Setter, default_setter<T>> &&
+                                                 std::same_as<Sync, sync::none>;
+        // True when the getter is told about every write.
+        static constexpr bool has_write_hook = WriteHookGetterFn<Getter, T>;
+        // True when the getter has a separate hook for moves out of the attr.
+        static constexpr bool has_moved_from_hook = MovedFromHookGetterFn<Getter, T>;
+        // True when readers load a copy of the value published after each write.
+        static constexpr bool publishes_value = Internal::PublishingPolicy<Sync>;
+        // True when modify()/write() hand out the stored value itself rather than a copy.
+        static constexpr bool modifies_in_place = std::same_as<Setter, default_setter<T>> || ModifyHookFn<Setter, T>;
 
         static_assert(!std::is_reference_v<value_type>, "attr of a reference type is ill-formed");
         static_assert(!std::is_same_v<value_type, std::in_place_t>, "attr of a in_place_t type is ill-formed");
 
-        constexpr attr_impl() noexcept = default;
+        constexpr attr_impl() noexcept requires (!publishes_value) = default;
+
+        attr_impl() noexcept requires publishes_value {
+            _publish();
+        }
         constexpr ~attr_impl() = default;
 
-        explicit constexpr attr_impl(const value_type&value) : BaseType(value) {
+        explicit constexpr attr_impl(const value_type&value) requires (!runs_setter_on_construction)
+            : BaseType(value) {
+            _publish();
+        }
+
+        explicit constexpr attr_impl(const value_type&value) requires runs_setter_on_construction : attr_impl() {
+            _setter(this->val, value);
+            _publish();
         }
 
         explicit constexpr attr_impl(value_type&&value) noexcept(std::is_nothrow_move_constructible_v<T>)
+            requires (!runs_setter_on_construction)
             : BaseType(std::move(value)) {
+            _publish();
+        }
+
+        explicit constexpr attr_impl(value_type&&value) requires runs_setter_on_construction : attr_impl() {
+            _setter(this->val, std::move(value));
+            _publish();
         }
 
-        attr_impl(const attr_impl&other) : BaseType() {
-            setter(this->val, other._get());
+        constexpr attr_impl(const attr_impl&) requires has_trivial_copy = default;
+
+        constexpr attr_impl(const attr_impl&other)
+            requires (!has_trivial_copy && !runs_setter_on_construction && !is_synchronized)
+            : BaseType(std::in_place, other.val) {
         }
 
-        attr_impl(attr_impl&&other) noexcept : BaseType() {
-            setter(this->val, std::move(other.val));
+        attr_impl(const attr_impl&other) requires (is_synchronized && !runs_setter_on_construction)
+            : BaseType(other._read_copy()) {
+            _publish();
+        }
+
+        constexpr attr_impl(const attr_impl&other) requires runs_setter_on_construction : attr_impl() {
+            if constexpr (is_synchronized) {
+                _setter(this->val, other._read_copy());
+                _publish();
+            } else {
+                _setter(this->val, other.val);
+            }
+        }
+
+        constexpr attr_impl(attr_impl&&) requires has_trivial_copy = default;
+
+        constexpr attr_impl(attr_impl&&other) noexcept(std::is_nothrow_move_constructible_v<T> &&
+                                                       has_nothrow_moved_from_hook)
+            requires (!has_trivial_copy && !runs_setter_on_construction && !is_synchronized)
+            : BaseType(std::in_place, std::move(other.val)) {
+            other._moved_from();
+        }
+
+        attr_impl(attr_impl&&other) requires (is_synchronized && !runs_setter_on_construction)
+            : BaseType(other._take()) {
+            _publish();
+        }
+
+        constexpr attr_impl(attr_impl&&other) requires runs_setter_on_construction : attr_impl() {
+            if constexpr (is_synchronized) {
+                _setter(this->val, other._take());
+                _publish();
+            } else {
+                _setter(this->val, std::move(other.val));
+                other._moved_from();
+            }
         }
 
         template<typename... Args>
         constexpr explicit attr_impl(std::in_place_t, Args&&... args) : BaseType(std::in_place, std::forward<Args>(args)...) {
+            _publish();
+        }
+
+        template<typename U, typename... Args>
+            requires std::constructible_from<std::remove_cv_t<T>, std::initializer_list<U> &, Args...>
+        constexpr explicit attr_impl(std::in_place_t, std::initializer_list<U> initList, Args&&... args)
+            : BaseType(std::in_place, initList, std::forward<Args>(args)...) {
+            _publish();
         }
 
         template<typename U = value_type>
-            requires AttrConstructible<T, U>
+            requires AttrConstructible<T, U> && (!std::same_as<std::remove_cvref_t<U>, attr_impl>) &&
+                     (!runs_setter_on_construction)
         constexpr explicit attr_impl(U&&value)
             : BaseType(std::in_place, std::forward<U>(value)) {
+            _publish();
         }
 
-        inline attr_impl& operator=(const attr_impl&other) {
-            setter(this->val, other._get());
+        template<typename U = value_type>
+            requires AttrConstructible<T, U> && (!std::same_as<std::remove_cvref_t<U>, attr_impl>) &&
+                     runs_setter_on_construction
+        explicit constexpr attr_impl(U&&value) : attr_impl() {
+            _setter(this->val, std::remove_cv_t<T>(std::forward<U>(value)));
+            _publish();
+        }
+
+        constexpr attr_impl& operator=(const attr_impl&) requires has_trivial_copy = default;
+
+        // Synchronized attrs copy the source under its lock and only then lock the target,
+        // so the two locks are never held together.
+        constexpr attr_impl& operator=(const attr_impl&other) requires (!has_trivial_copy) {
+            if constexpr (is_synchronized) {
+                auto copy = other._read_copy();
+                Internal::sync_guard guard(_sync);
+                _setter(this->val, std::move(copy));
+                _after_write();
+            } else {
+                Internal::sync_guard guard(_sync);
+                _setter(this->val, other.val);
+                _after_write();
+            }
             return *this;
         }
 
-        inline attr_impl& operator=(attr_impl&&other) noexcept(std::is_nothrow_move_assignable_v<value_type> &&
-                                                     std::is_nothrow_move_constructible_v<value_type>) {
-            setter(this->val, std::move(other.val));
+        constexpr attr_impl& operator=(attr_impl&&) requires has_trivial_copy = default;
+
+        constexpr attr_impl& operator=(attr_impl&&other) noexcept(std::is_nothrow_move_assignable_v<value_type> &&
+                                                     std::is_nothrow_move_constructible_v<value_type> &&
+                                                     has_nothrow_write_hook)
+            requires (!has_trivial_copy) {
+            if constexpr (is_synchronized) {
+                auto moved = other._take();
+                Internal::sync_guard guard(_sync);
+                _setter(this->val, std::move(moved));
+                _after_write();
+            } else {
+                Internal::sync_guard guard(_sync);
+                _setter(this->val, std::move(other.val));
+                _after_write();
+                other._moved_from();
+            }
             return *this;
         }
 
+        // Heterogeneous assignment: with default_setter the argument is assigned straight to the
+        // stored value (a const char* or string_view into a std::string reuses its buffer);
+        // other setters receive a T constructed from it, by rvalue.
         template<class U>
-            requires std::same_as<std::decay_t<U>, T>
-        inline attr_impl& operator=(U&&u) {
-            _setter(this->val, std::move(std::forward<U>(u)));
+            requires (!std::same_as<std::remove_cvref_t<U>, attr_impl>) &&
+                     std::constructible_from<std::remove_cv_t<T>, U>
+        constexpr attr_impl& operator=(U&&u) {
+            Internal::sync_guard guard(_sync);
+            if constexpr (std::same_as<std::remove_cvref_t<U>, std::remove_cv_t<T>>) {
+                _setter(this->val, std::forward<U>(u));
+            } else if constexpr (std::same_as<Setter, default_setter<T>> &&
+                                 std::is_assignable_v<std::remove_cv_t<T>&, U>) {
+                this->val = std::forward<U>(u);
+            } else {
+                _setter(this->val, std::remove_cv_t<T>(std::forward<U>(u)));
+            }
+            _after_write();
             return *this;
         }
 
-        inline void swap(attr_impl&other)
-            noexcept(std::is_nothrow_move_constructible_v<T> && std::is_nothrow_swappable_v<T>) {
-            using std::swap;
-            auto tmp = _get();
-            setter(this->val, other._get());
-            other.setter(other.val, tmp);
+        // Constructs a new value from args. With default_setter and a non-throwing constructor
+        // the value is rebuilt in place; otherwise the setter receives the new value by rvalue.
+        template<typename... Args>
+            requires std::constructible_from<std::remove_cv_t<T>, Args...>
+        constexpr decltype(auto) emplace(Args&&... args) {
+            {
+                Internal::sync_guard guard(_sync);
+                _emplace(std::forward<Args>(args)...);
+            }
+            return get();
+        }
+
+        template<typename U, typename... Args>
+            requires std::constructible_from<std::remove_cv_t<T>, std::initializer_list<U> &, Args...>
+        constexpr decltype(auto) emplace(std::initializer_list<U> initList, Args&&... args) {
+            {
+                Internal::sync_guard guard(_sync);
+                _emplace(initList, std::forward<Args>(args)...);
+            }
+            return get();
+        }
+
+        // With default_setter the stored values are exchanged directly (a pointer swap for
+        // std::string and containers); otherwise both values go through their setters.
+        // Synchronized attrs hold both locks, taken in address order, and resume coroutines
+        // awaiting either attr once both are released.
+        constexpr void swap(attr_impl&other)
+            noexcept(!is_synchronized && has_nothrow_write_hook &&
+                     (std::same_as<Setter, default_setter<T>> ? std::is_nothrow_swappable_v<std::remove_cv_t<T>>
+                                                             : std::is_nothrow_move_constructible_v<T> &&
+                                                               std::is_nothrow_invocable_v<const Setter&, std::remove_cv_t<T>&,
+                                                                   std::remove_cv_t<T>&&>)) {
+            if constexpr (!std::same_as<Sync, sync::none>) {
+                if (this == &other) {
+                    return;
+                }
+                const bool this_first = std::less<const attr_impl*>()(this, &other);
+                Internal::sync_pair_guard guard((this_first ? *this : other)._sync, (this_first ? other : *this)._sync);
+                _swap_values(other);
+            } else {
+                _swap_values(other);
+            }
         }
 
-        operator T() const { return _get(); }
+        // The number of writes so far, for policies that count them (sync::versioned).
+        constexpr auto version() const noexcept requires requires(const Sync&sync) { sync.version(); } {
+            return _sync.version();
+        }
 
-        constexpr std::strong_ordering operator<=>(const attr_impl&rhs) const {
-            return _get() <=> rhs._get();
+        // Blocks until a write completes after the one that produced version, for policies
+        // that can wait (sync::versioned over a locking policy). Writers wake waiters
+        // themselves; there is no separate notify step.
+        void wait_for_change(std::uint64_t version) const
+            requires requires(const Sync&sync) { sync.wait_for_change(std::uint64_t{}); } {
+            _sync.wait_for_change(version);
+        }
+
+        // Blocks until the stored value differs from old.
+        void wait(const value_type&old) const
+            requires std::equality_comparable<value_type> &&
+                     requires(const Sync&sync) { sync.wait_for_change(std::uint64_t{}); } {
+            for (;;) {
+                const auto seen = version();
+                if (!_read([&](const std::remove_cv_t<T>&value) { return value == old; })) {
+                    return;
+                }
+                wait_for_change(seen);
+            }
+        }
+
+        // co_await attr.changed() resumes after the next write completes and yields the value
+        // read then; co_await attr.until(pred) resumes once pred holds for the value, at once
+        // if it already does. Both resume the coroutine through executor(handle). The
+        // awaiter lives in the awaiting coroutine's frame, so waiting does not allocate. For
+        // policies that support it (sync::versioned over a locking policy).
+        template<typename Executor = inline_executor>
+            requires requires(const Sync&sync, const attr_impl&self, Executor executor) {
+                sync.changed(self, std::move(executor));
+            }
+        auto changed(Executor executor = {}) const {
+            return _sync.changed(*this, std::move(executor));
+        }
+
+        template<typename Predicate, typename Executor = inline_executor>
+            requires requires(const Sync&sync, const attr_impl&self, Predicate predicate, Executor executor) {
+                sync.until(self, std::move(predicate), std::move(executor));
+            }
+        auto until(Predicate predicate, Executor executor = {}) const {
+            return _sync.until(*this, std::move(predicate), std::move(executor));
+        }
+
+        class ValueWriter;
+
+        // Scoped write access: the returned writer exposes a mutable value, and the setter's
+        // after_modify hook (or, failing that, the setter with the modified copy) runs once
+        // when the writer goes out of scope. A synchronized attr stays locked until then.
+        [[nodiscard]] constexpr ValueWriter write() { return ValueWriter(*this); }
+
+        template<typename F>
+            requires std::invocable<F, std::remove_cv_t<T>&>
+        constexpr auto modify(F&&fn) {
+            if constexpr (std::same_as<Setter, default_setter<T>> && !has_write_hook && !publishes_value) {
+                Internal::sync_guard guard(_sync);
+                return std::invoke(std::forward<F>(fn), this->val);
+            } else {
+                ValueWriter writer(*this);
+                return std::invoke(std::forward<F>(fn), *writer);
+            }
+        }
+
+        // Compound assignment and increments apply directly to the storage with default
+        // hooks, go through the setter's update() hook when it has one, and otherwise
+        // behave like modify().
+#define ATTR_COMPOUND_ASSIGNMENT(op)                                                        \
+        template<typename U>                                                                \
+            requires requires(std::remove_cv_t<T>& value, U&& rhs) { value op std::forward<U>(rhs); } \
+        constexpr attr_impl& operator op(U&&rhs) {                                          \
+            _update([&rhs](std::remove_cv_t<T>& value) { value op std::forward<U>(rhs); }); \
+            return *this;                                                                   \
+        }
+
+        ATTR_COMPOUND_ASSIGNMENT(+=)
+        ATTR_COMPOUND_ASSIGNMENT(-=)
+        ATTR_COMPOUND_ASSIGNMENT(*=)
+        ATTR_COMPOUND_ASSIGNMENT(/=)
+        ATTR_COMPOUND_ASSIGNMENT(%=)
+        ATTR_COMPOUND_ASSIGNMENT(&=)
+        ATTR_COMPOUND_ASSIGNMENT(|=)
+        ATTR_COMPOUND_ASSIGNMENT(^=)
+        ATTR_COMPOUND_ASSIGNMENT(<<=)
+        ATTR_COMPOUND_ASSIGNMENT(>>=)
+#undef ATTR_COMPOUND_ASSIGNMENT
+
+        constexpr attr_impl& operator++() requires requires(std::remove_cv_t<T>& value) { ++value; } {
+            _update([](std::remove_cv_t<T>& value) { ++value; });
+            return *this;
+        }
+
+        constexpr attr_impl& operator--() requires requires(std::remove_cv_t<T>& value) { --value; } {
+            _update([](std::remove_cv_t<T>& value) { --value; });
+            return *this;
+        }
+
+        constexpr std::remove_cv_t<T> operator++(int) requires requires(std::remove_cv_t<T>& value) { ++value; } {
+            return _post_update([](std::remove_cv_t<T>& value) { ++value; });
+        }
+
+        constexpr std::remove_cv_t<T> operator--(int) requires requires(std::remove_cv_t<T>& value) { --value; } {
+            return _post_update([](std::remove_cv_t<T>& value) { --value; });
+        }
+
+        // Returns whatever the getter produces: const T& for default_getter and other
+        // reference-returning getters, otherwise the getter's value or proxy. Synchronized
+        // attrs run the getter under the lock and return its result by value.
+        constexpr decltype(auto) get() const {
+            if constexpr (is_synchronized) {
+                return _read([this](const std::remove_cv_t<T>&value) {
+                    return std::remove_cvref_t<getter_result_type>(_getter(value));
+                });
+            } else {
+                return _getter(this->val);
+            }
+        }
+
+        constexpr decltype(auto) operator*() const { return get(); }
+
+        constexpr auto operator->() const {
+            if constexpr (has_reference_getter && !is_synchronized) {
+                return std::addressof(get());
+            } else {
+                return Internal::arrow_proxy<std::remove_cvref_t<getter_result_type>>{get()};
+            }
+        }
+
+        constexpr operator T() const & requires std::convertible_to<getter_result_type, T> { return get(); }
+
+        // With the identity getter an expiring attr can hand its value out by move.
+        constexpr operator T() && requires std::same_as<Getter, default_getter<T>> {
+            if constexpr (is_synchronized) {
+                return _take();
+            } else {
+                T moved(std::move(this->val));
+                _moved_from();
+                return moved;
+            }
+        }
+
+        // Comparisons and hashing work on whatever get() returns, so attrs with reference
+        // getters compare their stored values in place.
+        constexpr auto operator<=>(const attr_impl&rhs) const {
+            if constexpr (is_synchronized) {
+                return _read_both(rhs, [](const auto&lhs_result, const auto&rhs_result) {
+                    return lhs_result <=> rhs_result;
+                });
+            } else {
+                return get() <=> rhs.get();
+            }
         }
 
         constexpr auto operator<=>(const T&value) const {
-            return _get() <=> value;
+            return get() <=> value;
         }
 
         constexpr bool operator==(const attr_impl&rhs) const {
-            return _get() == rhs._get();
+            if constexpr (is_synchronized) {
+                return _read_both(rhs, [](const auto&lhs_result, const auto&rhs_result) {
+                    return lhs_result == rhs_result;
+                });
+            } else {
+                return get() == rhs.get();
+            }
         }
 
         constexpr bool operator==(const T&value) const {
-            return _get() == value;
+            return get() == value;
         }
 
         class ValueGetter {
             friend class attr_impl;
 
         protected:
-            GetterType getter;
+            ATTR_NO_UNIQUE_ADDRESS GetterType getter;
 
-            explicit ValueGetter() : getter(Getter{}) {}
+            explicit constexpr ValueGetter() requires std::is_empty_v<Getter> = default;
 
-            explicit ValueGetter(Getter g) : getter(g) {
+            explicit constexpr ValueGetter() requires (!std::is_empty_v<Getter>) : getter(Getter{}) {}
+
+            explicit constexpr ValueGetter(Getter g) : getter(g) {
             }
 
         public:
 
-            inline auto operator()(const value_type& val) const {
-                return getter(val);
+            constexpr decltype(auto) operator()(const value_type& val) const {
+                return std::invoke(getter, val);
+            }
+
+            constexpr void after_write(const value_type& val) const requires WriteHookGetterFn<Getter, T> {
+                getter.after_write(val);
+            }
+
+            constexpr void after_moved_from(const value_type& val) const noexcept
+                requires MovedFromHookGetterFn<Getter, T> {
+                getter.after_moved_from(val);
             }
         };
 
@@ -244,78 +816,324 @@ namespace touka {
             friend class attr_impl;
 
         protected:
-            SetterType setter;
+            ATTR_NO_UNIQUE_ADDRESS SetterType setter;
+
+            explicit constexpr ValueSetter() requires std::is_empty_v<Setter> = default;
+
+            explicit constexpr ValueSetter() requires (!std::is_empty_v<Setter>) : setter(Setter{}) {}
+
+            explicit constexpr ValueSetter(Setter s) : setter(s) {
+            }
+
+        public:
+            constexpr void operator()(value_type& val, const value_type &new_val) const  {
+                std::invoke(setter, val, new_val);
+            }
+
+            constexpr void operator()(value_type& val, value_type &&new_val) const  {
+                std::invoke(setter, val, std::move(new_val));
+            }
+
+            constexpr void after_modify(value_type& val) const requires ModifyHookFn<Setter, T> {
+                setter.after_modify(val);
+            }
+
+            template<typename Op>
+            constexpr void update(value_type& val, Op&& op) const requires UpdateFn<Setter, T> {
+                setter.update(val, std::forward<Op>(op));
+            }
+        };
+
+        class ValueWriter {
+            friend class attr_impl;
 
-            explicit ValueSetter() : setter(Setter{}) {}
+            using stored_type = std::remove_cv_t<T>;
 
-            explicit ValueSetter(Setter s) : setter(s) {
+            attr_impl& _owner;
+            // Declared before the copy so the lock is taken first and released last.
+            ATTR_NO_UNIQUE_ADDRESS Internal::sync_guard<Sync> _guard;
+            ATTR_NO_UNIQUE_ADDRESS std::conditional_t<modifies_in_place, Internal::empty_slot, stored_type> _copy;
+            int _exceptions;
+
+            explicit constexpr ValueWriter(attr_impl& owner) requires modifies_in_place
+                : _owner(owner), _guard(owner._sync), _exceptions(uncaught_exceptions()) {
+            }
+
+            explicit constexpr ValueWriter(attr_impl& owner) requires (!modifies_in_place)
+                : _owner(owner), _guard(owner._sync), _copy(owner.val), _exceptions(uncaught_exceptions()) {
+            }
+
+            static constexpr int uncaught_exceptions() noexcept {
+                return std::is_constant_evaluated() ? 0 : std::uncaught_exceptions();
             }
 
         public:
-            inline void operator()(value_type& val, const value_type &new_val) const  {
-                setter(val, new_val);
+            ValueWriter(const ValueWriter&) = delete;
+            ValueWriter& operator=(const ValueWriter&) = delete;
+
+            // A copy is only committed when the scope exits normally, so a throwing update
+            // leaves the attr untouched. An in-place update that throws part way keeps what it
+            // changed, but the setter's after_modify hook is skipped: it could only throw
+            // into the unwinding and terminate.
+            constexpr ~ValueWriter() noexcept(false) {
+                if (uncaught_exceptions() > _exceptions) {
+                    if constexpr (modifies_in_place) {
+                        _owner._after_interrupted_write();
+                    }
+                    return;
+                }
+                if constexpr (ModifyHookFn<Setter, T>) {
+                    _owner._setter.after_modify(_owner.val);
+                } else if constexpr (!modifies_in_place) {
+                    _owner._setter(_owner.val, std::move(_copy));
+                }
+                _owner._after_write();
+            }
+
+            constexpr stored_type& operator*() noexcept {
+                if constexpr (modifies_in_place) {
+                    return _owner.val;
+                } else {
+                    return _copy;
+                }
             }
+
+            constexpr stored_type* operator->() noexcept { return std::addressof(**this); }
         };
 
     private:
 
-        ValueGetter _getter;
-        ValueSetter _setter;
+        ATTR_NO_UNIQUE_ADDRESS ValueGetter _getter;
+        ATTR_NO_UNIQUE_ADDRESS ValueSetter _setter;
+        ATTR_NO_UNIQUE_ADDRESS mutable Sync _sync;
+        ATTR_NO_UNIQUE_ADDRESS std::conditional_t<publishes_value, Internal::atomic_words<std::remove_cv_t<T>>,
+            Internal::empty_slot> _published;
 
-        template<class... Args>
-        inline void construct_value(Args&&... args) {
-            ::new(std::addressof(val)) value_type(std::forward<Args>(args)...);
+        static constexpr bool has_nothrow_write_hook =
+                !has_write_hook || requires(const Getter&getter, const T&value) {
+                    { getter.after_write(value) } noexcept;
+                };
+
+        static constexpr bool has_nothrow_moved_from_hook = has_moved_from_hook || has_nothrow_write_hook;
+
+        // Stores the value for readers of publishing policies; called with the writer's lock
+        // held, or before the attr is shared.
+        constexpr void _publish() noexcept {
+            if constexpr (publishes_value) {
+                _published.store(this->val);
+            }
         }
 
-        inline T* get_value_address() {
-            return std::bit_cast<T *>(std::addressof(val));
+        // Publishes a write and tells the getter about it; called with the writer's lock still held.
+        constexpr void _after_write() noexcept(has_nothrow_write_hook) {
+            _publish();
+            if constexpr (has_write_hook) {
+                _getter.after_write(this->val);
+            }
         }
 
-        inline const T* get_value_address() const {
-            return std::bit_cast<T *>(std::addressof(val));
+        // _after_write() for an in-place update that threw part way, run while unwinding: the
+        // getter is only told if that cannot throw, or drops its cache if it has the hook.
+        constexpr void _after_interrupted_write() noexcept {
+            if constexpr (has_nothrow_write_hook) {
+                _after_write();
+            } else if constexpr (has_moved_from_hook) {
+                _publish();
+                _getter.after_moved_from(this->val);
+            } else {
+                _publish();
+            }
         }
 
-        constexpr value_type _get() const noexcept { return _getter(this->val); }
-    };
+        // Counts moving the value out of an unsynchronized attr as a write, for the getter and
+        // for policies that count writes when their guard is released (sync::versioned<>).
+        // Getters with an after_moved_from() hook get that instead of after_write().
+        constexpr void _moved_from() noexcept(has_nothrow_moved_from_hook) {
+            Internal::sync_guard guard(_sync);
+            if constexpr (has_moved_from_hook) {
+                _publish();
+                _getter.after_moved_from(this->val);
+            } else {
+                _after_write();
+            }
+        }
 
-    template<class T>
-    inline constexpr bool operator==(const attr_impl<T>&lhs, const attr_impl<T>&rhs) {
-        return lhs == rhs;
-    }
+        template<typename Op>
+        constexpr void _update(Op&&op) {
+            if constexpr (UpdateFn<Setter, T>) {
+                Internal::sync_guard guard(_sync);
+                _setter.update(this->val, std::forward<Op>(op));
+                _after_write();
+            } else {
+                modify(std::forward<Op>(op));
+            }
+        }
 
-    template<class T>
-    inline constexpr auto operator<=>(const attr_impl<T>&lhs, const attr_impl<T>&rhs) {
-        return lhs <=> rhs;
-    }
+        // Applies op like _update() and returns the value from before it, both under one lock.
+        template<typename Op>
+        constexpr std::remove_cv_t<T> _post_update(Op op) {
+            if constexpr (UpdateFn<Setter, T>) {
+                Internal::sync_guard guard(_sync);
+                std::remove_cv_t<T> previous(this->val);
+                _setter.update(this->val, op);
+                _after_write();
+                return previous;
+            } else {
+                ValueWriter writer(*this);
+                std::remove_cv_t<T> previous(*writer);
+                op(*writer);
+                return previous;
+            }
+        }
 
-    template<class T>
-    constexpr auto operator<=>(const T&value, const attr_impl<T>&opt) {
-        return value <=> opt;
-    }
+        constexpr void _swap_values(attr_impl&other) {
+            if constexpr (std::same_as<Setter, default_setter<T>>) {
+                using std::swap;
+                swap(this->val, other.val);
+            } else {
+                std::remove_cv_t<T> tmp(std::move(this->val));
+                _setter(this->val, std::move(other.val));
+                other._setter(other.val, std::move(tmp));
+            }
+            _after_write();
+            other._after_write();
+        }
 
-    template<class T>
-    constexpr bool operator==(const T&value, const attr_impl<T>&opt) {
-        return value == opt;
-    }
+        // Runs fn on the stored value with the policy's reader side held. Policies that read
+        // optimistically (sync::seqlock) provide read() and hand fn a validated copy of the
+        // published value.
+        template<typename F>
+        decltype(auto) _read(F&&fn) const {
+            if constexpr (publishes_value) {
+                return _sync.read(_published, fn);
+            } else if constexpr (requires { _sync.read(this->val, fn); }) {
+                return _sync.read(this->val, fn);
+            } else {
+                Internal::shared_sync_guard guard(_sync);
+                return std::invoke(fn, this->val);
+            }
+        }
 
-    template<class Tp>
+        std::remove_cv_t<T> _read_copy() const {
+            return _read([](const std::remove_cv_t<T>&value) { return std::remove_cv_t<T>(value); });
+        }
+
+        std::remove_cv_t<T> _take() {
+            Internal::sync_guard guard(_sync);
+            std::remove_cv_t<T> taken(std::move(this->val));
+            _after_write();
+            return taken;
+        }
+
+        // Runs fn on both getter results with both reader sides held, taken in address order.
+        template<typename F>
+        auto _read_both(const attr_impl&rhs, F fn) const {
+            if (this == &rhs) {
+                return _read([&](const std::remove_cv_t<T>&value) {
+                    return fn(_getter(value), _getter(value));
+                });
+            }
+            const bool this_first = std::less<const attr_impl*>()(this, &rhs);
+            const attr_impl&first = this_first ? *this : rhs;
+            const attr_impl&second = this_first ? rhs : *this;
+            return first._read([&](const std::remove_cv_t<T>&first_value) {
+                return second._read([&](const std::remove_cv_t<T>&second_value) {
+                    return this_first ? fn(first._getter(first_value), second._getter(second_value))
+                                      : fn(second._getter(second_value), first._getter(first_value));
+                });
+            });
+        }
+
+        template<typename... Args>
+        constexpr void _emplace(Args&&... args) {
+            if constexpr (std::same_as<Setter, default_setter<T>> &&
+                          std::is_nothrow_constructible_v<std::remove_cv_t<T>, Args...>) {
+                std::destroy_at(std::addressof(this->val));
+                construct_value(std::forward<Args>(args)...);
+            } else {
+                _setter(this->val, std::remove_cv_t<T>(std::forward<Args>(args)...));
+            }
+            _after_write();
+        }
+
+        template<class... Args>
+        constexpr void construct_value(Args&&... args) {
+            std::construct_at(std::addressof(val), std::forward<Args>(args)...);
+        }
+
+        constexpr auto* get_value_address() {
+            return std::addressof(val);
+        }
+
+        constexpr const auto* get_value_address() const {
+            return std::addressof(val);
+        }
+    };
+
+    template<class Tp, class Getter, class Setter, class Sync>
     inline constexpr std::enable_if_t<std::is_move_constructible_v<Tp> && std::is_swappable_v<Tp>, void>
-    swap(attr_impl<Tp>&lhs, attr_impl<Tp>&rhs) noexcept(noexcept(lhs.swap(rhs))) {
+    swap(attr_impl<Tp, Getter, Setter, Sync>&lhs, attr_impl<Tp, Getter, Setter, Sync>&rhs) noexcept(noexcept(lhs.swap(rhs))) {
         lhs.swap(rhs);
     }
 
-    template<typename T, auto Getter, auto Setter>
+    // Customization point: specialize to true for types whose objects can be moved to new
+    // storage with memcpy, the source being released without running its destructor.
+    template<typename T>
+    struct is_trivially_relocatable : std::bool_constant<std::is_trivially_copyable_v<T>> {
+    };
+
+    template<typename T>
+    inline constexpr bool is_trivially_relocatable_v = is_trivially_relocatable<T>::value;
+
+    // A synchronized attr never is: a lock may be identified by its address, and some
+    // implementations report lock types as trivially copyable because every copy is deleted.
+    template<typename T, typename Getter, typename Setter, typename Sync>
+    struct is_trivially_relocatable<attr_impl<T, Getter, Setter, Sync>>
+        : std::bool_constant<is_trivially_relocatable_v<std::remove_cv_t<T>> &&
+                             is_trivially_relocatable_v<Getter> &&
+                             is_trivially_relocatable_v<Setter> &&
+                             !Internal::SynchronizingPolicy<Sync> &&
+                             is_trivially_relocatable_v<Sync>> {
+    };
+
+    // Moves [first, last) into the uninitialized storage at dest and ends the lifetime of
+    // the source objects; the ranges must not overlap. Returns the end of the new range.
+    template<typename T>
+    inline T* uninitialized_relocate(T* first, T* last, T* dest)
+        noexcept(is_trivially_relocatable_v<T> || std::is_nothrow_move_constructible_v<T>) {
+        if constexpr (is_trivially_relocatable_v<T>) {
+            const auto count = static_cast<std::size_t>(last - first);
+            if (count != 0) {
+                std::memcpy(static_cast<void *>(dest), static_cast<const void *>(first), count * sizeof(T));
+            }
+            return dest + count;
+        } else {
+            for (; first != last; ++first, ++dest) {
+                std::construct_at(dest, std::move(*first));
+                std::destroy_at(first);
+            }
+            return dest;
+        }
+    }
+
+    template<typename T, auto Getter = default_getter<T>{}, auto Setter = default_setter<T>{}, typename Sync = sync::none>
     using attr = attr_impl<T,
                 std::decay_t<decltype(Getter)>,
-                std::decay_t<decltype(Setter)>>;
+                std::decay_t<decltype(Setter)>,
+                Sync>;
 
 }
 
 namespace std {
-    template<class T>
-    struct hash<std::__enable_hash_helper<touka::attr_impl<T>, remove_const_t<T>>> {
-        size_t operator()(const touka::attr_impl<T>&attr) const noexcept {
-            return hash<std::remove_const_t<T>>()(attr._get());
+    // Hashes the getter's result, so attrs hash like the value (or view) they expose.
+    // Only enabled when that result type itself has an enabled std::hash.
+    template<class T, class Getter, class Setter, class Sync>
+        requires is_default_constructible_v<hash<remove_cvref_t<touka::getter_result_t<Getter, T>>>>
+    struct hash<touka::attr_impl<T, Getter, Setter, Sync>> {
+        size_t operator()(const touka::attr_impl<T, Getter, Setter, Sync>&attr) const
+            noexcept(is_nothrow_invocable_v<hash<remove_cvref_t<touka::getter_result_t<Getter, T>>>,
+                                            touka::getter_result_t<Getter, T>>) {
+            return hash<remove_cvref_t<touka::getter_result_t<Getter, T>>>()(attr.get());
         }
     };
 }
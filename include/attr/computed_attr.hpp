@@ -0,0 +1,152 @@
+#ifndef COMPUTED_ATTR_HPP
+#define COMPUTED_ATTR_HPP
+#include "attr.hpp"
+#include "function_ref.hpp"
+#include "observable_attr.hpp"
+
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace touka {
+    // Something a computed_attr can be derived from: it has a value and can register a
+    // dependent to invalidate when that value changes. observable_attr and computed_attr
+    // itself both qualify.
+    template<typename D>
+    concept Dependency = requires(D&dependency, const D&const_dependency, function_ref<void()> invalidate,
+                                  std::uint64_t id) {
+        const_dependency.get();
+        { dependency.add_dependent(invalidate) } -> std::convertible_to<std::uint64_t>;
+        { dependency.remove_dependent(id) } -> std::convertible_to<bool>;
+    };
+
+    // A read-only attr whose value is fn applied to the get() results of its dependencies.
+    // Nothing is computed when a dependency changes: the change only marks this attr and,
+    // transitively, everything derived from it as stale. The next get() recomputes, first
+    // bringing any stale dependency up to date in the order they were passed, so a graph is
+    // evaluated in dependency order, each node at most once per change, and only the parts
+    // that are actually read.
+    //
+    //     touka::observable_attr<int> width(2), height(3);
+    //     touka::computed_attr<int> area([](int w, int h) { return w * h; }, width, height);
+    //     width = 4;    // marks area stale
+    //     int a = area; // computes 12 and remembers it
+    //
+    // Dependencies must outlive the computed_attr. Like observable_attr it is not thread-safe,
+    // and neither copyable nor movable since its dependencies refer to it.
+    template<typename T, typename Getter = default_getter<T>>
+        requires GetterFn<Getter, T>
+    class computed_attr {
+    public:
+        using value_type = T;
+        using GetterType = Getter;
+        using result_type = std::remove_cvref_t<getter_result_t<Getter, T>>;
+        using subscription = std::uint64_t;
+
+        template<typename F, Dependency... Deps>
+            requires std::convertible_to<std::invoke_result_t<F&, decltype(std::declval<const Deps&>().get())...>, T>
+        explicit computed_attr(F fn, Deps&... deps)
+            : _compute([fn = std::move(fn), &deps...]() mutable -> T {
+                // Braced initialization reads the dependencies left to right.
+                return std::apply(fn, std::tuple<decltype(deps.get())...>{deps.get()...});
+            }) {
+            try {
+                (_link(deps), ...);
+            } catch (...) {
+                _unlink();
+                throw;
+            }
+        }
+
+        computed_attr(const computed_attr&) = delete;
+        computed_attr& operator=(const computed_attr&) = delete;
+
+        ~computed_attr() { _unlink(); }
+
+        // Recomputes first if a dependency changed since the last call.
+        decltype(auto) get() const { return std::invoke(_getter, _current()); }
+
+        decltype(auto) operator*() const { return get(); }
+
+        operator T() const requires std::convertible_to<getter_result_t<Getter, T>, T> { return get(); }
+
+        auto operator<=>(const T&value) const { return get() <=> value; }
+
+        bool operator==(const T&value) const { return get() == value; }
+
+        // True when the next get() will recompute.
+        bool stale() const noexcept { return _stale; }
+
+        subscription add_dependent(function_ref<void()> invalidate) { return _dependents.add(invalidate); }
+
+        bool remove_dependent(subscription id) noexcept { return _dependents.remove(id); }
+
+    private:
+        // What dependencies call: marks this attr stale and passes the mark on. An attr that
+        // is already stale has already marked everything derived from it.
+        struct invalidator {
+            computed_attr*owner;
+
+            void operator()() const {
+                if (!owner->_stale) {
+                    owner->_stale = true;
+                    owner->_dependents.invalidate();
+                }
+            }
+        };
+
+        struct link {
+            void*dependency;
+            bool (*remove)(void*, std::uint64_t) noexcept;
+            std::uint64_t id;
+        };
+
+        template<typename D>
+        void _link(D&dependency) {
+            const std::uint64_t id = dependency.add_dependent(_invalidator);
+            try {
+                _links.push_back(link{
+                    std::addressof(dependency),
+                    [](void*target, std::uint64_t dependent) noexcept -> bool {
+                        return static_cast<D *>(target)->remove_dependent(dependent);
+                    },
+                    id
+                });
+            } catch (...) {
+                dependency.remove_dependent(id);
+                throw;
+            }
+        }
+
+        void _unlink() noexcept {
+            for (std::size_t i = 0; i < _links.size(); ++i) {
+                _links[i].remove(_links[i].dependency, _links[i].id);
+            }
+            _links.clear();
+        }
+
+        const T& _current() const {
+            if (_stale) {
+                _value.emplace(_compute());
+                _stale = false;
+            }
+            return *_value;
+        }
+
+        std::function<T()> _compute;
+        mutable std::optional<T> _value;
+        mutable bool _stale = true;
+        invalidator _invalidator{this};
+        Internal::small_vector<link, 4> _links;
+        Internal::dependent_list _dependents;
+        ATTR_NO_UNIQUE_ADDRESS Getter _getter{};
+    };
+}
+
+#endif //COMPUTED_ATTR_HPP
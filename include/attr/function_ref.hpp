@@ -0,0 +1,89 @@
+#ifndef ATTR_FUNCTION_REF_HPP
+#define ATTR_FUNCTION_REF_HPP
+
+#include <bit>
+#include <concepts>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace touka {
+    namespace Internal {
+        // What a function_ref calls and how: equal for function_refs bound to the same
+        // callable with the same signature, whatever their type.
+        struct callable_identity {
+            const void*target;
+            const void*call;
+
+            friend bool operator==(const callable_identity&, const callable_identity&) = default;
+        };
+    }
+
+    template<typename Signature>
+    class function_ref;
+
+    // A non-owning, non-allocating reference to a callable: two pointers, trivially copyable.
+    // The referenced callable must outlive every call. Function pointers and stateless
+    // callables such as captureless lambdas are stored by value; any other temporary is
+    // rejected, since it would be destroyed before the first call.
+    template<typename R, typename... Args>
+    class function_ref<R(Args...)> {
+        template<typename F>
+        static constexpr bool stored_by_value =
+                std::is_function_v<std::remove_pointer_t<std::decay_t<F>>> ||
+                (std::is_empty_v<std::remove_cvref_t<F>> && std::default_initializable<std::remove_cvref_t<F>>);
+
+    public:
+        template<typename F>
+            requires (!std::same_as<std::remove_cvref_t<F>, function_ref>) &&
+                     std::is_invocable_r_v<R, F&, Args...> &&
+                     (std::is_lvalue_reference_v<F> || stored_by_value<F>)
+        function_ref(F&&f) noexcept {
+            using callable = std::remove_reference_t<F>;
+            if constexpr (std::is_function_v<std::remove_pointer_t<std::decay_t<F>>>) {
+                using function_pointer = std::decay_t<F>;
+                _target.function = reinterpret_cast<void (*)()>(static_cast<function_pointer>(f));
+                _call = [](target t, Args... args) -> R {
+                    return std::invoke(reinterpret_cast<function_pointer>(t.function), std::forward<Args>(args)...);
+                };
+            } else if constexpr (stored_by_value<F>) {
+                _target.object = nullptr;
+                _call = [](target, Args... args) -> R {
+                    std::remove_cvref_t<F> stateless;
+                    return std::invoke(stateless, std::forward<Args>(args)...);
+                };
+            } else {
+                _target.object = const_cast<void *>(static_cast<const void *>(std::addressof(f)));
+                _call = [](target t, Args... args) -> R {
+                    return std::invoke(*static_cast<callable *>(t.object), std::forward<Args>(args)...);
+                };
+            }
+        }
+
+        template<typename F>
+            requires (!std::same_as<std::remove_cvref_t<F>, function_ref>) &&
+                     std::is_invocable_r_v<R, F&, Args...> &&
+                     (!std::is_lvalue_reference_v<F> && !stored_by_value<F>)
+        function_ref(F&&) = delete;
+
+        R operator()(Args... args) const {
+            return _call(_target, std::forward<Args>(args)...);
+        }
+
+        Internal::callable_identity identity() const noexcept {
+            return {std::bit_cast<const void *>(_target), std::bit_cast<const void *>(_call)};
+        }
+
+    private:
+        union target {
+            void*object;
+            void (*function)();
+        };
+
+        target _target;
+        R (*_call)(target, Args...);
+    };
+}
+
+#endif //ATTR_FUNCTION_REF_HPP
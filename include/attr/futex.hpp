@@ -0,0 +1,75 @@
+#ifndef ATTR_FUTEX_HPP
+#define ATTR_FUTEX_HPP
+
+#include <atomic>
+#include <climits>
+#include <cstdint>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace touka {
+    namespace Internal {
+        // Blocking on 32-bit words. On Linux these are direct futex calls: a blocked waiter
+        // costs no CPU, and a wake with nobody waiting is one system call, which callers avoid
+        // by counting waiters. Elsewhere they fall back to std::atomic::wait and notify.
+        // Waits may return spuriously; callers re-check their condition in a loop.
+        static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t),
+                      "futex words must be plain 32-bit integers");
+
+        // Sleeps while the 32-bit word at address still holds expected. The address may be
+        // any object whose representation is a 32-bit word, such as std::atomic<float>.
+        inline void futex_wait(const void*address, std::uint32_t expected) noexcept {
+#if defined(__linux__)
+            syscall(SYS_futex, address, FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+#else
+            static_cast<const std::atomic<std::uint32_t> *>(address)->wait(expected, std::memory_order_relaxed);
+#endif
+        }
+
+        inline void futex_wake_one(void*address) noexcept {
+#if defined(__linux__)
+            syscall(SYS_futex, address, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#else
+            static_cast<std::atomic<std::uint32_t> *>(address)->notify_one();
+#endif
+        }
+
+        inline void futex_wake_all(void*address) noexcept {
+#if defined(__linux__)
+            syscall(SYS_futex, address, FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+#else
+            static_cast<std::atomic<std::uint32_t> *>(address)->notify_all();
+#endif
+        }
+
+        // Waits until word moves away from the value it held when the caller decided to wait,
+        // registering in waiters for the duration so that writers know to wake it.
+        // still_waiting() re-checks the caller's condition after registering.
+        template<typename Predicate>
+        void futex_wait_while(const std::atomic<std::uint32_t>&word, std::atomic<std::uint32_t>&waiters,
+                              Predicate still_waiting) noexcept {
+            waiters.fetch_add(1, std::memory_order_seq_cst);
+            for (;;) {
+                const std::uint32_t current = word.load(std::memory_order_seq_cst);
+                if (!still_waiting()) {
+                    break;
+                }
+                futex_wait(&word, current);
+            }
+            waiters.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        // The writer half of futex_wait_while(): call after publishing a change to word.
+        inline void futex_wake_waiters(std::atomic<std::uint32_t>&word, const std::atomic<std::uint32_t>&waiters) noexcept {
+            if (waiters.load(std::memory_order_seq_cst) != 0) {
+                futex_wake_all(&word);
+            }
+        }
+    } // namespace Internal
+}
+
+#endif //ATTR_FUTEX_HPP
@@ -0,0 +1,182 @@
+#ifndef ATTR_MEMOIZED_GETTER_HPP
+#define ATTR_MEMOIZED_GETTER_HPP
+#include "attr.hpp"
+#include "futex.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace touka {
+    // When a memoized_getter runs the getter it wraps.
+    enum class memoize {
+        // Right after every write, so that reads only load the remembered result.
+        eager,
+        // On the first read after a write, so that values overwritten unread cost nothing.
+        lazy,
+    };
+
+    // A getter that remembers what Getter returned for the stored value and hands out a
+    // reference to it until the attr is next written, for getters that are expensive next
+    // to a read (formatting, unit conversion, decompression) on attrs read far more often
+    // than they are written. attr_impl reports every write through after_write().
+    //
+    //     using fahrenheit = touka::memoized_getter<double, to_fahrenheit, touka::memoize::eager>;
+    //     touka::attr_impl<double, fahrenheit> temperature(21.5);
+    //     temperature = 22.0;         // runs to_fahrenheit
+    //     double shown = temperature; // loads the result
+    //
+    // Both policies compute on the first read of an attr that has not been written since it
+    // was constructed, or since its value was moved out: moves never run the getter, so
+    // attrs stay nothrow-movable and containers of them relocate without recomputing.
+    //
+    // The result is stored next to the value and is not synchronized: use it on attrs read by
+    // one thread at a time, with sync::none, sync::spinlock or sync::mutex, and
+    // concurrent_memoized_getter on attrs whose readers share a lock. attr_impl rejects it
+    // under sync::shared_mutex and sync::seqlock.
+    template<typename T, typename Getter, memoize When = memoize::lazy>
+        requires GetterFn<Getter, T>
+    class memoized_getter {
+    public:
+        using result_type = std::remove_cvref_t<getter_result_t<Getter, T>>;
+
+        // Reads write the cached result; see ReadableUnderPolicy.
+        static constexpr bool shared_reads = false;
+
+        memoized_getter() = default;
+
+        explicit memoized_getter(Getter getter) : _getter(std::move(getter)) {
+        }
+
+        // Computes when nothing is remembered: before the first write, after a lazy
+        // invalidation, or after an eager recomputation threw.
+        const result_type& operator()(const T&value) const {
+            if (!_result) [[unlikely]] {
+                _result.emplace(std::invoke(_getter, value));
+            }
+            return *_result;
+        }
+
+        void after_write(const T&value) const noexcept(When == memoize::lazy || nothrow_compute) {
+            _result.reset();
+            if constexpr (When == memoize::eager) {
+                _result.emplace(std::invoke(_getter, value));
+            }
+        }
+
+        void after_moved_from(const T&) const noexcept {
+            _result.reset();
+        }
+
+    private:
+        static constexpr bool nothrow_compute = std::is_nothrow_invocable_v<const Getter&, const T&> &&
+                                                std::is_nothrow_constructible_v<result_type, getter_result_t<Getter, T>>;
+
+        ATTR_NO_UNIQUE_ADDRESS Getter _getter{};
+        mutable std::optional<result_type> _result;
+    };
+
+    // A lazy memoized_getter for attrs read by many threads at once, typically under
+    // sync::shared_mutex. Every write starts a new version; the first reader of a version
+    // runs Getter while the readers arriving meanwhile sleep until its result is stored, so
+    // a burst of reads after a write runs the getter once rather than once per thread.
+    // Reads of a version that has been computed are an acquire load and a compare.
+    //
+    // Writers must exclude readers, as every locking policy does. Under sync::seqlock the
+    // getter sees copies that a writer may already have replaced, so attr_impl rejects it.
+    // If the getter throws, the exception reaches the reader that ran it and the next
+    // reader of the version tries again.
+    template<typename T, typename Getter>
+        requires GetterFn<Getter, T>
+    class concurrent_memoized_getter {
+    public:
+        using result_type = std::remove_cvref_t<getter_result_t<Getter, T>>;
+
+        // Readers may share a lock but not overlap a write; see ReadableUnderPolicy.
+        static constexpr bool unlocked_reads = false;
+
+        concurrent_memoized_getter() = default;
+
+        explicit concurrent_memoized_getter(Getter getter) : _getter(std::move(getter)) {
+        }
+
+        // Copies start with nothing remembered, since the atomics cannot be copied.
+        concurrent_memoized_getter(const concurrent_memoized_getter&other) : _getter(other._getter) {
+        }
+
+        concurrent_memoized_getter& operator=(const concurrent_memoized_getter&) = delete;
+
+        // The result stays valid until the next write.
+        const result_type& operator()(const T&value) const {
+            if ((_state.load(std::memory_order_acquire) & phase_mask) == ready) [[likely]] {
+                return *_result;
+            }
+            return _compute(value);
+        }
+
+        // Runs with the writer's lock held, so no reader is looking at the result.
+        void after_write(const T&) const noexcept {
+            _result.reset();
+            const std::uint32_t version = (_state.load(std::memory_order_relaxed) >> phase_bits) + 1;
+            _state.store(version << phase_bits | stale, std::memory_order_release);
+        }
+
+        // Counts writes seen, modulo 2^30.
+        std::uint32_t version() const noexcept {
+            return _state.load(std::memory_order_acquire) >> phase_bits;
+        }
+
+    private:
+        // The futex word holds the version in its upper bits and where its result stands in
+        // the lowest two.
+        static constexpr std::uint32_t phase_bits = 2;
+        static constexpr std::uint32_t phase_mask = (1u << phase_bits) - 1;
+        static constexpr std::uint32_t stale = 0;
+        static constexpr std::uint32_t computing = 1;
+        static constexpr std::uint32_t ready = 2;
+
+        const result_type& _compute(const T&value) const {
+            for (;;) {
+                std::uint32_t state = _state.load(std::memory_order_acquire);
+                const std::uint32_t version_bits = state & ~phase_mask;
+                switch (state & phase_mask) {
+                    case ready:
+                        return *_result;
+                    case stale:
+                        if (_state.compare_exchange_strong(state, version_bits | computing, std::memory_order_acquire,
+                                                           std::memory_order_relaxed)) {
+                            try {
+                                _result.emplace(std::invoke(_getter, value));
+                            } catch (...) {
+                                _publish(version_bits | stale);
+                                throw;
+                            }
+                            _publish(version_bits | ready);
+                            return *_result;
+                        }
+                        break;
+                    default:
+                        Internal::futex_wait_while(_state, _waiters, [&] {
+                            return _state.load(std::memory_order_acquire) == (version_bits | computing);
+                        });
+                        break;
+                }
+            }
+        }
+
+        void _publish(std::uint32_t state) const noexcept {
+            _state.store(state, std::memory_order_seq_cst);
+            Internal::futex_wake_waiters(_state, _waiters);
+        }
+
+        ATTR_NO_UNIQUE_ADDRESS Getter _getter{};
+        mutable std::optional<result_type> _result;
+        mutable std::atomic<std::uint32_t> _state{stale};
+        mutable std::atomic<std::uint32_t> _waiters{0};
+    };
+}
+
+#endif //ATTR_MEMOIZED_GETTER_HPP
@@ -0,0 +1,707 @@
+#ifndef OBSERVABLE_ATTR_HPP
+#define OBSERVABLE_ATTR_HPP
+#include "attr.hpp"
+#include "function_ref.hpp"
+
+#include <concepts>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#ifndef ATTR_NOINLINE
+#if defined(_MSC_VER) && !defined(__clang__)
+#define ATTR_NOINLINE __declspec(noinline)
+#else
+#define ATTR_NOINLINE __attribute__((noinline))
+#endif
+#endif
+
+namespace touka {
+    namespace Internal {
+        // A vector of trivially copyable elements whose first N elements live inline, so
+        // small collections never allocate. Elements keep their insertion order. Larger
+        // collections get their storage from a default-constructed Allocator.
+        template<typename T, std::size_t N, typename Allocator = std::allocator<T>>
+        class small_vector {
+            static_assert(std::is_trivially_copyable_v<T>, "small_vector relocates its elements with memcpy");
+
+            using allocator_traits = std::allocator_traits<Allocator>;
+
+        public:
+            small_vector() noexcept = default;
+
+            small_vector(const small_vector&) = delete;
+            small_vector& operator=(const small_vector&) = delete;
+
+            ~small_vector() {
+                if (_heap) {
+                    allocator_traits::deallocate(_allocator, _heap, _capacity);
+                }
+            }
+
+            bool empty() const noexcept { return _size == 0; }
+
+            std::size_t size() const noexcept { return _size; }
+
+            bool is_inline() const noexcept { return _heap == nullptr; }
+
+            T* data() noexcept { return _heap ? _heap : std::launder(reinterpret_cast<T *>(_inline)); }
+
+            const T* data() const noexcept {
+                return _heap ? _heap : std::launder(reinterpret_cast<const T *>(_inline));
+            }
+
+            T& operator[](std::size_t index) noexcept { return data()[index]; }
+
+            const T& operator[](std::size_t index) const noexcept { return data()[index]; }
+
+            void push_back(const T&value) {
+                if (_size == _capacity) {
+                    grow();
+                }
+                std::construct_at(data() + _size, value);
+                ++_size;
+            }
+
+            void clear() noexcept { _size = 0; }
+
+            void erase(std::size_t index) noexcept {
+                T*elements = data();
+                std::memmove(static_cast<void *>(elements + index), static_cast<const void *>(elements + index + 1),
+                             (_size - index - 1) * sizeof(T));
+                --_size;
+            }
+
+            // Keeps the elements for which keep() returns true, in order.
+            template<typename Predicate>
+            void retain(Predicate keep) noexcept {
+                T*elements = data();
+                std::size_t kept = 0;
+                for (std::size_t i = 0; i < _size; ++i) {
+                    if (keep(elements[i])) {
+                        elements[kept++] = elements[i];
+                    }
+                }
+                _size = kept;
+            }
+
+        private:
+            void grow() {
+                const std::size_t capacity = _capacity * 2;
+                T*heap = allocator_traits::allocate(_allocator, capacity);
+                std::memcpy(static_cast<void *>(heap), static_cast<const void *>(data()), _size * sizeof(T));
+                if (_heap) {
+                    allocator_traits::deallocate(_allocator, _heap, _capacity);
+                }
+                _heap = heap;
+                _capacity = capacity;
+            }
+
+            std::size_t _size = 0;
+            std::size_t _capacity = N;
+            T*_heap = nullptr;
+            alignas(T) unsigned char _inline[N * sizeof(T)];
+            ATTR_NO_UNIQUE_ADDRESS Allocator _allocator{};
+        };
+
+        // The derived values that must be marked stale when an attr changes. Unlike
+        // subscribers, dependents run on every change, even inside a notification_batch,
+        // and receive no value: they only record that they need recomputing. They must not
+        // add or remove dependents while being invalidated.
+        class dependent_list {
+        public:
+            using callback_type = function_ref<void()>;
+
+            bool empty() const noexcept { return _dependents.empty(); }
+
+            std::size_t size() const noexcept { return _dependents.size(); }
+
+            std::uint64_t add(callback_type invalidate) {
+                const std::uint64_t id = ++_last_id;
+                _dependents.push_back(dependent{id, invalidate});
+                return id;
+            }
+
+            bool remove(std::uint64_t id) noexcept {
+                for (std::size_t i = 0; i < _dependents.size(); ++i) {
+                    if (_dependents[i].id == id) {
+                        _dependents.erase(i);
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            void invalidate() const {
+                for (std::size_t i = 0; i < _dependents.size(); ++i) {
+                    _dependents[i].invalidate();
+                }
+            }
+
+        private:
+            struct dependent {
+                std::uint64_t id;
+                callback_type invalidate;
+            };
+
+            small_vector<dependent, 2> _dependents;
+            std::uint64_t _last_id = 0;
+        };
+
+        // The subscribers of an observable_attr, kept as a slot map. A handle is a slot index
+        // tagged with the slot's generation, which is bumped whenever the slot is released, so
+        // removing is O(1) and a handle that outlived its subscription simply stops matching,
+        // even once the slot has been reused. Callbacks live in a dense array in subscription
+        // order, which is the only thing notifying walks. Removal leaves a dead entry in place;
+        // compact_if_sparse() squeezes them out once they make up more than half of the array,
+        // so the array is empty exactly when it was last compacted with nothing subscribed.
+        template<typename Callback, std::size_t N, typename Allocator = std::allocator<std::byte>>
+        class subscriber_table {
+        public:
+            // (generation << 32) | slot; generations start at 1, so a handle is never 0.
+            using handle = std::uint64_t;
+
+            struct entry {
+                Callback callback;
+                std::uint32_t slot;
+
+                bool live() const noexcept { return slot != npos; }
+            };
+
+            // Entries in the dense array, dead ones included.
+            std::size_t extent() const noexcept { return _entries.size(); }
+
+            std::size_t live() const noexcept { return _entries.size() - _dead; }
+
+            const entry& operator[](std::size_t index) const noexcept { return _entries[index]; }
+
+            bool contains(handle id) const noexcept { return _find(id) != npos; }
+
+            // The callback subscribed as id, or nullptr once it is no longer.
+            const Callback* find(handle id) const noexcept {
+                const std::uint32_t slot = _find(id);
+                return slot == npos ? nullptr : &_entries[_slots[slot].index].callback;
+            }
+
+            // The handle of the live entry at index.
+            handle id_of(std::size_t index) const noexcept {
+                const std::uint32_t slot = _entries[index].slot;
+                return static_cast<handle>(_slots[slot].generation) << 32 | slot;
+            }
+
+            handle add(Callback callback) {
+                if (_free == npos) {
+                    // A new slot goes on the free list first, so a failed push below leaves it there.
+                    _free = static_cast<std::uint32_t>(_slots.size());
+                    _slots.push_back(slot_state{1, npos});
+                }
+                const std::uint32_t slot = _free;
+                _entries.push_back(entry{callback, slot});
+                slot_state&state = _slots[slot];
+                _free = state.index;
+                state.index = static_cast<std::uint32_t>(_entries.size() - 1);
+                return static_cast<handle>(state.generation) << 32 | slot;
+            }
+
+            // Returns false for handles that are stale or were never issued. Does not compact,
+            // so it is safe while the dense array is being walked.
+            bool remove(handle id) noexcept {
+                const std::uint32_t slot = _find(id);
+                if (slot == npos) {
+                    return false;
+                }
+                slot_state&state = _slots[slot];
+                _entries[state.index].slot = npos;
+                ++_dead;
+                if (++state.generation == 0) {
+                    state.generation = 1;
+                }
+                state.index = _free;
+                _free = slot;
+                return true;
+            }
+
+            void compact_if_sparse() noexcept {
+                if (_dead * 2 <= _entries.size()) {
+                    return;
+                }
+                _entries.retain([](const entry&candidate) { return candidate.live(); });
+                for (std::size_t i = 0; i < _entries.size(); ++i) {
+                    _slots[_entries[i].slot].index = static_cast<std::uint32_t>(i);
+                }
+                _dead = 0;
+            }
+
+        private:
+            static constexpr std::uint32_t npos = UINT32_MAX;
+
+            // index is the entry's position in the dense array while the slot is in use,
+            // and the next free slot while it is not.
+            struct slot_state {
+                std::uint32_t generation;
+                std::uint32_t index;
+            };
+
+            // The slot id refers to while its subscription is live, otherwise npos.
+            std::uint32_t _find(handle id) const noexcept {
+                const auto slot = static_cast<std::uint32_t>(id);
+                if (slot >= _slots.size()) {
+                    return npos;
+                }
+                const slot_state&state = _slots[slot];
+                // A free slot's index links the free list; no live entry can point back to it.
+                if (state.generation != static_cast<std::uint32_t>(id >> 32) || state.index >= _entries.size() ||
+                    _entries[state.index].slot != slot) {
+                    return npos;
+                }
+                return slot;
+            }
+
+            template<typename U>
+            using allocator_for = typename std::allocator_traits<Allocator>::template rebind_alloc<U>;
+
+            small_vector<entry, N, allocator_for<entry>> _entries;
+            small_vector<slot_state, N, allocator_for<slot_state>> _slots;
+            std::uint32_t _free = npos;
+            std::size_t _dead = 0;
+        };
+
+        // Per-thread bookkeeping for notification_batch: how deeply batches are nested and
+        // which listeners have notifications pending, in the order first deferred. A listener
+        // is identified by the callable its callback refers to, so one subscribed to several
+        // attrs that changed has a single entry, which names the attr that changed last.
+        class batch_state {
+        public:
+            struct pending {
+                callable_identity listener;
+                void*owner;
+                std::uint64_t subscription;
+                void (*deliver)(void*, std::uint64_t);
+            };
+
+            static batch_state& current() noexcept {
+                thread_local batch_state state;
+                return state;
+            }
+
+            bool active() const noexcept { return _depth != 0; }
+
+            // Changes whenever a pending listener is called, moves to another attr or the
+            // outermost batch ends, so an attr that deferred its listeners at the current
+            // stamp knows they are all still pending on it.
+            std::uint64_t stamp() const noexcept { return _stamp; }
+
+            void enter() noexcept { ++_depth; }
+
+            // Leaving the outermost batch calls each pending listener once. The batch stays
+            // open meanwhile, so writes made by the callbacks are coalesced into the same
+            // pass: a listener still waiting for its call is not queued again, and one already
+            // called is queued anew.
+            void leave() {
+                if (_depth == 1) {
+                    while (_next < _queue.size()) {
+                        const pending entry = _queue[_next++];
+                        ++_stamp;
+                        if (entry.owner) {
+                            entry.deliver(entry.owner, entry.subscription);
+                        }
+                    }
+                    _queue.clear();
+                    _next = 0;
+                    ++_stamp;
+                }
+                --_depth;
+            }
+
+            void defer(const pending&entry) {
+                for (std::size_t i = _next; i < _queue.size(); ++i) {
+                    if (_queue[i].listener == entry.listener && _queue[i].owner) {
+                        if (_queue[i].owner != entry.owner) {
+                            ++_stamp;
+                        }
+                        _queue[i] = entry;
+                        return;
+                    }
+                }
+                _queue.push_back(entry);
+            }
+
+            // Drops the pending notifications of an attr destroyed before the batch ended.
+            void forget(const void*owner) noexcept {
+                for (std::size_t i = _next; i < _queue.size(); ++i) {
+                    if (_queue[i].owner == owner) {
+                        _queue[i].owner = nullptr;
+                    }
+                }
+            }
+
+        private:
+            unsigned _depth = 0;
+            std::size_t _next = 0;
+            std::uint64_t _stamp = 1;
+            small_vector<pending, 16> _queue;
+        };
+    } // namespace Internal
+
+    // Defers the notifications of observable_attrs written on this thread until the outermost
+    // batch ends. Each listener of the changed attrs is then called once with a final value,
+    // however often and however many of its attrs were written, so listeners recompute once
+    // per batch instead of once per write. A listener is the callable a subscription refers
+    // to; subscribed to several attrs that changed, it receives the value of the attr written
+    // last. Batches nest; only leaving the outermost one notifies. Callbacks run from the
+    // destructor and must not throw.
+    //
+    //     {
+    //         touka::notification_batch batch;
+    //         shape.width = 4;
+    //         shape.height = 3;
+    //     } // subscribers of width and height are called here, once each
+    //
+    // Changes of an attr destroyed inside the batch are dropped.
+    class notification_batch {
+    public:
+        notification_batch() noexcept { Internal::batch_state::current().enter(); }
+
+        notification_batch(const notification_batch&) = delete;
+        notification_batch& operator=(const notification_batch&) = delete;
+
+        ~notification_batch() { Internal::batch_state::current().leave(); }
+    };
+
+    // An attr that calls its subscribers after every write that changes what get() returns.
+    // Callbacks are function_refs, so subscribing never allocates for the first
+    // InlineSubscribers of them, and the callables must outlive their subscription;
+    // temporaries other than captureless lambdas do not compile. Further subscribers are
+    // stored in memory from a default-constructed Allocator, rebound to the table's types.
+    // With no subscribers or dependents a write costs one extra branch over a plain attr_impl.
+    // Unsubscribing is O(1) however many subscribers there are, and notifying walks a
+    // contiguous array.
+    //
+    // Subscribers may subscribe, unsubscribe or write the attr from inside a callback;
+    // subscribers added during a notification first hear about the next write. A change made
+    // by a callback is delivered to every subscriber at once and ends the notification it
+    // interrupted, so each subscriber sees the values in the order they were written, ends
+    // with the latest, and never receives a value that has already been overwritten.
+    template<typename T, typename Getter = default_getter<T>, typename Setter = default_setter<T>,
+        std::size_t InlineSubscribers = 4, typename Allocator = std::allocator<std::byte>>
+    class observable_attr {
+    public:
+        using attr_type = attr_impl<T, Getter, Setter>;
+        using value_type = T;
+        using result_type = std::remove_cvref_t<getter_result_t<Getter, T>>;
+        using callback_type = function_ref<void(const result_type&)>;
+        // Identifies a subscription for unsubscribe(): a slot index tagged with a generation,
+        // so ids of ended subscriptions are recognised as stale. Never 0.
+        using subscription = std::uint64_t;
+
+        observable_attr() = default;
+
+        explicit observable_attr(const T&value) : _attr(value) {
+        }
+
+        explicit observable_attr(T&&value) : _attr(std::move(value)) {
+        }
+
+        template<typename... Args>
+        explicit observable_attr(std::in_place_t, Args&&... args) : _attr(std::in_place, std::forward<Args>(args)...) {
+        }
+
+        // Subscriptions refer to this object, so it is neither copied nor moved.
+        observable_attr(const observable_attr&) = delete;
+        observable_attr& operator=(const observable_attr&) = delete;
+
+        ~observable_attr() {
+            if (_deferred) {
+                Internal::batch_state::current().forget(this);
+            }
+        }
+
+        subscription subscribe(callback_type callback) {
+            const subscription id = _subscribers.add(callback);
+            // The next write inside a batch defers the new subscriber too.
+            _deferred_at = 0;
+            return id;
+        }
+
+        // O(1). Returns false when id is not (or no longer) subscribed; a stale id never
+        // removes the subscription that has since taken over its slot.
+        bool unsubscribe(subscription id) noexcept {
+            if (!_subscribers.remove(id)) {
+                return false;
+            }
+            if (_notifying == 0) {
+                _subscribers.compact_if_sparse();
+            }
+            return true;
+        }
+
+        // Whether id still refers to a live subscription.
+        bool subscribed(subscription id) const noexcept { return _subscribers.contains(id); }
+
+        // Registers a derived value, such as a computed_attr, to be invalidated whenever
+        // what get() returns changes. See Internal::dependent_list.
+        subscription add_dependent(function_ref<void()> invalidate) { return _dependents.add(invalidate); }
+
+        bool remove_dependent(subscription id) noexcept { return _dependents.remove(id); }
+
+        std::size_t subscriber_count() const noexcept { return _subscribers.live(); }
+
+        template<typename Predicate, typename Executor>
+        class change_awaiter;
+
+        // co_await attr.changed() resumes after the next notified change and yields the new
+        // value; co_await attr.until(pred) resumes once pred holds for the value, at once if
+        // it already does. The awaiter subscribes itself from the awaiting coroutine's frame
+        // and is resumed through executor(handle) from the notification, so inside a
+        // notification_batch it wakes when the batch ends.
+        template<typename Executor = inline_executor>
+        change_awaiter<Internal::accept_any, Executor> changed(Executor executor = {}) {
+            return change_awaiter<Internal::accept_any, Executor>(*this, {}, std::move(executor), false);
+        }
+
+        template<typename Predicate, typename Executor = inline_executor>
+            requires std::predicate<Predicate&, const result_type&>
+        change_awaiter<Predicate, Executor> until(Predicate predicate, Executor executor = {}) {
+            return change_awaiter<Predicate, Executor>(*this, std::move(predicate), std::move(executor), true);
+        }
+
+        decltype(auto) get() const { return _attr.get(); }
+
+        decltype(auto) operator*() const { return get(); }
+
+        auto operator->() const { return _attr.operator->(); }
+
+        operator T() const requires std::convertible_to<getter_result_t<Getter, T>, T> { return get(); }
+
+        auto operator<=>(const T&value) const { return _attr <=> value; }
+
+        bool operator==(const T&value) const { return _attr == value; }
+
+        template<typename U>
+            requires (!std::same_as<std::remove_cvref_t<U>, observable_attr>) && std::is_assignable_v<attr_type&, U>
+        observable_attr& operator=(U&&value) {
+            _write([&](attr_type&attr) { attr = std::forward<U>(value); });
+            return *this;
+        }
+
+        template<typename... Args>
+            requires std::constructible_from<std::remove_cv_t<T>, Args...>
+        void emplace(Args&&... args) {
+            _write([&](attr_type&attr) { attr.emplace(std::forward<Args>(args)...); });
+        }
+
+        template<typename F>
+            requires std::invocable<F, std::remove_cv_t<T>&>
+        void modify(F&&fn) {
+            _write([&](attr_type&attr) { attr.modify(std::forward<F>(fn)); });
+        }
+
+#define ATTR_OBSERVABLE_COMPOUND_ASSIGNMENT(op)                                               \
+        template<typename U>                                                                  \
+            requires requires(attr_type& attr, U&& rhs) { attr op std::forward<U>(rhs); }     \
+        observable_attr& operator op(U&&rhs) {                                                \
+            _write([&](attr_type& attr) { attr op std::forward<U>(rhs); });                   \
+            return *this;                                                                     \
+        }
+
+        ATTR_OBSERVABLE_COMPOUND_ASSIGNMENT(+=)
+        ATTR_OBSERVABLE_COMPOUND_ASSIGNMENT(-=)
+        ATTR_OBSERVABLE_COMPOUND_ASSIGNMENT(*=)
+        ATTR_OBSERVABLE_COMPOUND_ASSIGNMENT(/=)
+        ATTR_OBSERVABLE_COMPOUND_ASSIGNMENT(%=)
+        ATTR_OBSERVABLE_COMPOUND_ASSIGNMENT(&=)
+        ATTR_OBSERVABLE_COMPOUND_ASSIGNMENT(|=)
+        ATTR_OBSERVABLE_COMPOUND_ASSIGNMENT(^=)
+        ATTR_OBSERVABLE_COMPOUND_ASSIGNMENT(<<=)
+        ATTR_OBSERVABLE_COMPOUND_ASSIGNMENT(>>=)
+#undef ATTR_OBSERVABLE_COMPOUND_ASSIGNMENT
+
+        observable_attr& operator++() requires requires(attr_type&attr) { ++attr; } {
+            _write([](attr_type&attr) { ++attr; });
+            return *this;
+        }
+
+        observable_attr& operator--() requires requires(attr_type&attr) { --attr; } {
+            _write([](attr_type&attr) { --attr; });
+            return *this;
+        }
+
+        template<typename Predicate, typename Executor>
+        class change_awaiter {
+        public:
+            change_awaiter(observable_attr&owner, Predicate predicate, Executor executor, bool check_first)
+                : _owner(&owner), _predicate(std::move(predicate)), _executor(std::move(executor)),
+                  _check_first(check_first) {
+            }
+
+            // Subscribed by address.
+            change_awaiter(const change_awaiter&) = delete;
+            change_awaiter& operator=(const change_awaiter&) = delete;
+
+            // Only a coroutine destroyed while suspended is still subscribed.
+            ~change_awaiter() {
+                if (_subscription != 0) {
+                    _owner->unsubscribe(_subscription);
+                }
+            }
+
+            bool await_ready() {
+                if (_check_first && std::invoke(_predicate, std::as_const(_owner->get()))) {
+                    _value.emplace(_owner->get());
+                    return true;
+                }
+                return false;
+            }
+
+            void await_suspend(std::coroutine_handle<> handle) {
+                _handle = handle;
+                _subscription = _owner->subscribe(*this);
+            }
+
+            result_type await_resume() { return std::move(*_value); }
+
+            // The subscription callback.
+            void operator()(const result_type&value) {
+                if (!std::invoke(_predicate, value)) {
+                    return;
+                }
+                _value.emplace(value);
+                _owner->unsubscribe(std::exchange(_subscription, 0));
+                // May resume, finish and destroy this awaiter before returning.
+                _executor(_handle);
+            }
+
+        private:
+            observable_attr*_owner;
+            ATTR_NO_UNIQUE_ADDRESS Predicate _predicate;
+            ATTR_NO_UNIQUE_ADDRESS Executor _executor;
+            bool _check_first;
+            subscription _subscription = 0;
+            std::optional<result_type> _value;
+            std::coroutine_handle<> _handle;
+        };
+
+    private:
+        // Runs write on the underlying attr, then notifies if what get() returns changed.
+        // Results that cannot be compared always notify. Inside a notification_batch the
+        // notification is queued once and delivered when the batch ends.
+        template<typename Write>
+        void _write(Write&&write) {
+            // One branch for both lists.
+            if ((_subscribers.extent() | _dependents.size()) == 0) [[likely]] {
+                write(_attr);
+            } else {
+                _write_observed(write);
+            }
+        }
+
+        // Kept out of line so that the unobserved path above stays a test and a store.
+        template<typename Write>
+        ATTR_NOINLINE void _write_observed(Write&write) {
+            if constexpr (std::equality_comparable<result_type>) {
+                const result_type previous(_attr.get());
+                write(_attr);
+                if (previous == _attr.get()) {
+                    return;
+                }
+            } else {
+                write(_attr);
+            }
+            _dependents.invalidate();
+            if (_subscribers.extent() == 0) {
+                return;
+            }
+            ++_changes;
+            if (Internal::batch_state&batch = Internal::batch_state::current(); batch.active()) {
+                _defer(batch);
+            } else {
+                _notify();
+            }
+        }
+
+        // Queues every live subscriber with the batch, unless all of them are still queued
+        // from an earlier write.
+        void _defer(Internal::batch_state&batch) {
+            if (_deferred_at == batch.stamp()) {
+                return;
+            }
+            for (std::size_t i = 0; i < _subscribers.extent(); ++i) {
+                const auto&subscriber = _subscribers[i];
+                if (subscriber.live()) {
+                    batch.defer({subscriber.callback.identity(), this, _subscribers.id_of(i), &_deliver});
+                }
+            }
+            _deferred_at = batch.stamp();
+            _deferred = true;
+        }
+
+        static void _deliver(void*self, std::uint64_t id) {
+            auto&owner = *static_cast<observable_attr *>(self);
+            const callback_type*callback = owner._subscribers.find(id);
+            if (!callback) {
+                return;
+            }
+            const callback_type call = *callback;
+            notify_scope scope(owner);
+            call(owner._attr.get());
+        }
+
+        // Marks a notification in progress; the outermost one compacts away entries
+        // unsubscribed meanwhile, also when a callback throws.
+        class notify_scope {
+        public:
+            explicit notify_scope(observable_attr&owner) noexcept : _owner(owner) { ++_owner._notifying; }
+            notify_scope(const notify_scope&) = delete;
+            notify_scope& operator=(const notify_scope&) = delete;
+
+            ~notify_scope() {
+                if (--_owner._notifying == 0) {
+                    _owner._subscribers.compact_if_sparse();
+                }
+            }
+
+        private:
+            observable_attr&_owner;
+        };
+
+        void _notify() {
+            decltype(auto) value = _attr.get();
+            // Subscribers added by a callback are appended past count and wait for the next write.
+            // Nothing is compacted until the outermost notification ends, so positions are stable.
+            const std::size_t count = _subscribers.extent();
+            const std::uint64_t change = _changes;
+            notify_scope scope(*this);
+            for (std::size_t i = 0; i < count; ++i) {
+                // A copy, since a callback that subscribes may reallocate the array.
+                const auto subscriber = _subscribers[i];
+                if (subscriber.live()) {
+                    subscriber.callback(value);
+                    // A callback changed the value, and every subscriber has been given (or is
+                    // queued for) the newer one: value no longer holds what this pass delivers.
+                    if (_changes != change) {
+                        return;
+                    }
+                }
+            }
+        }
+
+        attr_type _attr{};
+        Internal::subscriber_table<callback_type, InlineSubscribers, Allocator> _subscribers;
+        Internal::dependent_list _dependents;
+        unsigned _notifying = 0;
+        // Counts changes dispatched to subscribers, so a notification notices newer ones.
+        std::uint64_t _changes = 0;
+        // The batch stamp at which the subscribers were last queued, and whether they ever were.
+        std::uint64_t _deferred_at = 0;
+        bool _deferred = false;
+    };
+}
+
+#endif //OBSERVABLE_ATTR_HPP
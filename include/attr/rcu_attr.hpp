@@ -0,0 +1,301 @@
+#ifndef RCU_ATTR_HPP
+#define RCU_ATTR_HPP
+#include "attr.hpp"
+
+#include <atomic>
+#include <concepts>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace touka {
+    // Tracks read-side critical sections for any number of rcu_attrs. Readers increment
+    // a counter in one of a fixed set of cache-line sized slots chosen per thread, so
+    // concurrent readers rarely share a line; the writer pays for the grace period instead.
+    class rcu_domain {
+    public:
+        rcu_domain() = default;
+
+        rcu_domain(const rcu_domain&) = delete;
+        rcu_domain& operator=(const rcu_domain&) = delete;
+
+        // No reader may remain, so whatever is still waiting in retire() can go.
+        ~rcu_domain() {
+            synchronize();
+        }
+
+        // The domain used by rcu_attrs constructed without one.
+        static rcu_domain& global() noexcept {
+            static rcu_domain domain;
+            return domain;
+        }
+
+        class read_lock {
+        public:
+            read_lock(read_lock&&other) noexcept
+                : _counter(std::exchange(other._counter, nullptr)) {
+            }
+
+            read_lock& operator=(read_lock&&other) noexcept {
+                if (this != &other) {
+                    unlock();
+                    _counter = std::exchange(other._counter, nullptr);
+                }
+                return *this;
+            }
+
+            ~read_lock() { unlock(); }
+
+            void unlock() noexcept {
+                if (_counter) {
+                    // Release: everything read under the lock happens before a writer reclaims it.
+                    _counter->fetch_sub(1, std::memory_order_release);
+                    _counter = nullptr;
+                    --reader_depth();
+                }
+            }
+
+        private:
+            friend class rcu_domain;
+
+            explicit read_lock(std::atomic<long>*counter) noexcept : _counter(counter) {
+            }
+
+            std::atomic<long>*_counter;
+        };
+
+        // Enters a read-side critical section. Pointers loaded after this call stay valid
+        // until the returned lock is released, which must happen on the same thread.
+        // Never call synchronize() while holding one; retire() is safe.
+        [[nodiscard]] read_lock lock() noexcept {
+            ++reader_depth();
+            slot&reader = _slots[this_thread_slot()];
+            const unsigned parity = _parity.load(std::memory_order_relaxed) & 1u;
+            reader.counters[parity].fetch_add(1, std::memory_order_seq_cst);
+            return read_lock(&reader.counters[parity]);
+        }
+
+        // Blocks until every read-side critical section that was already running has ended,
+        // then reclaims what retire() had queued before the call.
+        void synchronize() {
+            std::vector<retired> deferred;
+            {
+                std::scoped_lock lock(_deferred_mutex);
+                deferred.swap(_deferred);
+            }
+            _wait_for_readers();
+            for (const retired&entry : deferred) {
+                entry.reclaim(entry.pointer);
+            }
+        }
+
+        // Calls reclaim(pointer) once every read-side critical section that might still see
+        // pointer has ended; pointer must already be unreachable for new readers. Normally
+        // that means waiting in synchronize() right here. A thread that is itself inside a
+        // read-side critical section, of any domain, would wait for itself forever, so then
+        // pointer is queued instead and reclaimed by the next synchronize(), including the
+        // one in a retire() that can wait, or when the domain is destroyed.
+        void retire(void*pointer, void (*reclaim)(void*)) {
+            if (reader_depth() != 0) {
+                std::scoped_lock lock(_deferred_mutex);
+                _deferred.push_back(retired{pointer, reclaim});
+                return;
+            }
+            synchronize();
+            reclaim(pointer);
+        }
+
+        // Number of pointers retire() has queued and not yet reclaimed.
+        std::size_t pending() const {
+            std::scoped_lock lock(_deferred_mutex);
+            return _deferred.size();
+        }
+
+    private:
+        static constexpr std::size_t slot_count = 64;
+
+        struct retired {
+            void*pointer;
+            void (*reclaim)(void*);
+        };
+
+        // Read-side critical sections the calling thread is in, across all domains.
+        static std::size_t& reader_depth() noexcept {
+            thread_local std::size_t depth = 0;
+            return depth;
+        }
+
+        struct alignas(64) slot {
+            std::atomic<long> counters[2]{};
+        };
+
+        // Flipping the parity sends new readers to the other counter so the wait cannot be
+        // starved; the second flip covers readers that sampled the parity just before the first.
+        void _wait_for_readers() {
+            std::scoped_lock lock(_writer);
+            for (int flip = 0; flip < 2; ++flip) {
+                const unsigned parity = _parity.fetch_add(1, std::memory_order_seq_cst) & 1u;
+                for (slot&reader : _slots) {
+                    while (reader.counters[parity].load(std::memory_order_seq_cst) != 0) {
+                        std::this_thread::yield();
+                    }
+                }
+            }
+        }
+
+        static std::size_t this_thread_slot() noexcept {
+            static std::atomic<std::size_t> next{0};
+            thread_local const std::size_t index = next.fetch_add(1, std::memory_order_relaxed) % slot_count;
+            return index;
+        }
+
+        std::atomic<unsigned> _parity{0};
+        std::mutex _writer;
+        mutable std::mutex _deferred_mutex;
+        std::vector<retired> _deferred;
+        slot _slots[slot_count];
+    };
+
+    // A read-mostly attr for large values such as configuration maps. Readers take an
+    // immutable snapshot without touching a shared cache line; writers build a new value
+    // off to the side, publish it with one pointer store and reclaim the old one after a
+    // grace period. Writes are therefore expensive and serialized.
+    template<typename T, typename Getter = default_getter<T>, typename Setter = default_setter<T>>
+        requires GetterFn<Getter, T> && SetterFn<Setter, T>
+    class rcu_attr {
+    public:
+        using value_type = T;
+        using GetterType = Getter;
+        using SetterType = Setter;
+        using result_type = std::remove_cvref_t<getter_result_t<Getter, value_type>>;
+
+        // A pinned, immutable view of the value current when it was taken. Later writes
+        // do not affect it, and the value is not reclaimed until the snapshot is destroyed.
+        class snapshot {
+        public:
+            const T& operator*() const noexcept { return *_value; }
+
+            const T* operator->() const noexcept { return _value; }
+
+            decltype(auto) get() const { return std::invoke(_owner->_getter, *_value); }
+
+        private:
+            friend class rcu_attr;
+
+            snapshot(const rcu_attr&owner, rcu_domain::read_lock lock, const T*value) noexcept
+                : _owner(&owner), _lock(std::move(lock)), _value(value) {
+            }
+
+            const rcu_attr*_owner;
+            rcu_domain::read_lock _lock;
+            const T*_value;
+        };
+
+        rcu_attr() requires std::default_initializable<T> : rcu_attr(rcu_domain::global()) {
+        }
+
+        explicit rcu_attr(rcu_domain&domain) requires std::default_initializable<T>
+            : _domain(&domain), _value(new T()) {
+        }
+
+        template<typename... Args>
+            requires std::constructible_from<T, Args...>
+        explicit rcu_attr(std::in_place_t, Args&&... args)
+            : rcu_attr(rcu_domain::global(), std::in_place, std::forward<Args>(args)...) {
+        }
+
+        explicit rcu_attr(const T&value) : rcu_attr(std::in_place, value) {
+        }
+
+        explicit rcu_attr(T&&value) : rcu_attr(std::in_place, std::move(value)) {
+        }
+
+        // Attrs in their own domain wait only for each other's readers.
+        template<typename... Args>
+            requires std::constructible_from<T, Args...>
+        rcu_attr(rcu_domain&domain, std::in_place_t, Args&&... args)
+            : _domain(&domain), _value(new T(std::forward<Args>(args)...)) {
+        }
+
+        rcu_attr(rcu_domain&domain, const T&value) : rcu_attr(domain, std::in_place, value) {
+        }
+
+        rcu_attr(rcu_domain&domain, T&&value) : rcu_attr(domain, std::in_place, std::move(value)) {
+        }
+
+        rcu_attr(const rcu_attr&) = delete;
+        rcu_attr& operator=(const rcu_attr&) = delete;
+
+        // No reader may still hold a snapshot.
+        ~rcu_attr() {
+            delete _value.load(std::memory_order_relaxed);
+        }
+
+        [[nodiscard]] snapshot read() const noexcept {
+            auto lock = _domain->lock();
+            return snapshot(*this, std::move(lock), _value.load(std::memory_order_seq_cst));
+        }
+
+        // Returns by value, since the snapshot the getter ran on is released on return.
+        result_type get() const {
+            return read().get();
+        }
+
+        operator T() const requires std::convertible_to<result_type, T> { return get(); }
+
+        // Publishes a new value and waits for readers of the old one before destroying it.
+        // The default setter builds the new value straight from new_value; other setters
+        // are applied to a copy of the current value. Writing while this thread holds a
+        // snapshot, as in a.set(f(*a.read())), does not wait: the old value is then left to
+        // rcu_domain::retire() to destroy later.
+        template<typename U>
+            requires (!std::same_as<std::remove_cvref_t<U>, rcu_attr>) && std::constructible_from<T, U>
+        void set(U&&new_value) {
+            std::scoped_lock lock(_writer);
+            if constexpr (std::same_as<Setter, default_setter<T>>) {
+                _publish(std::make_unique<T>(std::forward<U>(new_value)));
+            } else {
+                auto next = std::make_unique<T>(*_value.load(std::memory_order_relaxed));
+                std::invoke(_setter, *next, T(std::forward<U>(new_value)));
+                _publish(std::move(next));
+            }
+        }
+
+        template<typename U>
+            requires (!std::same_as<std::remove_cvref_t<U>, rcu_attr>) && std::constructible_from<T, U>
+        rcu_attr& operator=(U&&new_value) {
+            set(std::forward<U>(new_value));
+            return *this;
+        }
+
+        // Applies fn to a copy of the current value, as Internal::modify_copy() describes, and
+        // publishes the result. Reclaims the old value like set().
+        template<typename F>
+            requires std::invocable<F&, T&>
+        void modify(F&&fn) {
+            std::scoped_lock lock(_writer);
+            auto next = std::make_unique<T>(*_value.load(std::memory_order_relaxed));
+            Internal::modify_copy(_setter, *next, fn);
+            _publish(std::move(next));
+        }
+
+    private:
+        void _publish(std::unique_ptr<T> next) {
+            T*previous = _value.exchange(next.release(), std::memory_order_seq_cst);
+            _domain->retire(previous, [](void*value) { delete static_cast<T *>(value); });
+        }
+
+        rcu_domain*_domain;
+        std::atomic<T*> _value;
+        std::mutex _writer;
+        ATTR_NO_UNIQUE_ADDRESS Getter _getter{};
+        ATTR_NO_UNIQUE_ADDRESS Setter _setter{};
+    };
+}
+
+#endif //RCU_ATTR_HPP
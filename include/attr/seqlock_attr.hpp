@@ -0,0 +1,111 @@
+#ifndef SEQLOCK_ATTR_HPP
+#define SEQLOCK_ATTR_HPP
+#include "attr.hpp"
+#include "sync.hpp"
+
+#include <concepts>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace touka {
+    // An attr for trivially copyable values too large to be lock-free (quotes, poses,
+    // statistics snapshots). Readers copy the value optimistically and retry if a writer
+    // published in the meantime; they never write shared memory, so they scale with the
+    // number of cores. The sequence counter and its writer side are sync::seqlock's.
+    //
+    // The payload is held as an array of relaxed atomic words, which keeps the torn reads a
+    // seqlock tolerates well-defined without giving up plain-load code generation.
+    template<typename T, typename Getter = default_getter<T>, typename Setter = default_setter<T>>
+        requires std::is_trivially_copyable_v<T> && std::default_initializable<T> && GetterFn<Getter, T> && SetterFn<Setter, T>
+    class seqlock_attr {
+    public:
+        using value_type = T;
+        using GetterType = Getter;
+        using SetterType = Setter;
+        using result_type = std::remove_cvref_t<getter_result_t<Getter, value_type>>;
+
+        seqlock_attr() noexcept(std::is_nothrow_default_constructible_v<T>)
+            : seqlock_attr(T()) {
+        }
+
+        explicit seqlock_attr(const T&value) noexcept : _words(value) {
+        }
+
+        seqlock_attr(const seqlock_attr&) = delete;
+        seqlock_attr& operator=(const seqlock_attr&) = delete;
+
+        // A consistent copy of the stored value.
+        T load() const noexcept {
+            return _lock.read(_words, [](const T&value) noexcept { return value; });
+        }
+
+        // Returns by value: the getter runs on a consistent copy, never on the shared storage.
+        result_type get() const {
+            return _lock.read(_words, _getter);
+        }
+
+        operator T() const requires std::convertible_to<result_type, T> { return get(); }
+
+        void set(const T&new_value) {
+            _write([&](T&value) { std::invoke(_setter, value, new_value); });
+        }
+
+        seqlock_attr& operator=(const T&new_value) {
+            set(new_value);
+            return *this;
+        }
+
+        // Applies fn to a copy of the current value while holding the writer side, then
+        // publishes it; see Internal::modify_copy() for how the setter sees the result.
+        // Returns the value published.
+        template<typename F>
+            requires std::invocable<F&, T&>
+        T modify(F&&fn) {
+            return _write([&](T&value) { Internal::modify_copy(_setter, value, fn); });
+        }
+
+        // Number of completed writes; changes whenever the published value may have.
+        std::uint32_t version() const noexcept {
+            return _lock.version();
+        }
+
+        // Blocks until a write completes after the one that produced version.
+        void wait_for_change(std::uint32_t version) const noexcept {
+            _lock.wait_for_change(version);
+        }
+
+        // Blocks until the stored value differs from old.
+        void wait(const T&old) const requires std::equality_comparable<T> {
+            for (;;) {
+                const std::uint32_t seen = version();
+                if (!(load() == old)) {
+                    return;
+                }
+                wait_for_change(seen);
+            }
+        }
+
+    private:
+        // Takes the writer side, runs apply on a private copy and publishes the result. A
+        // throwing apply leaves the published value as it was.
+        template<typename Apply>
+        T _write(Apply&&apply) {
+            Internal::sync_guard guard(_lock);
+            T value;
+            _words.load(std::addressof(value));
+            apply(value);
+            _words.store(value);
+            return value;
+        }
+
+        sync::seqlock _lock;
+        Internal::atomic_words<T> _words;
+        ATTR_NO_UNIQUE_ADDRESS Getter _getter{};
+        ATTR_NO_UNIQUE_ADDRESS Setter _setter{};
+    };
+}
+
+#endif //SEQLOCK_ATTR_HPP
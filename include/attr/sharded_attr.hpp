@@ -0,0 +1,194 @@
+#ifndef SHARDED_ATTR_HPP
+#define SHARDED_ATTR_HPP
+#include "attr.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <compare>
+#include <concepts>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+namespace touka {
+    namespace Internal {
+        // Index of the shard the calling thread should write to. On Linux this is the
+        // current CPU, which glibc reads from the kernel's rseq area without a system call,
+        // so threads that share a core share a line that stays in that core's cache.
+        // Elsewhere each thread keeps the slot it was first handed.
+        inline std::size_t current_shard_hint() noexcept {
+#if defined(__linux__)
+            const int cpu = sched_getcpu();
+            if (cpu >= 0) {
+                return static_cast<std::size_t>(cpu);
+            }
+#endif
+            static std::atomic<std::size_t> next{0};
+            thread_local const std::size_t index = next.fetch_add(1, std::memory_order_relaxed);
+            return index;
+        }
+
+        inline std::size_t default_shard_count() noexcept {
+            const std::size_t cores = std::max(1u, std::thread::hardware_concurrency());
+            std::size_t count = 1;
+            while (count < cores) {
+                count <<= 1;
+            }
+            return count;
+        }
+
+        template<typename T>
+        concept standard_integer = std::integral<T> && !std::same_as<T, bool> && !std::same_as<T, char> &&
+                                   !std::same_as<T, wchar_t> && !std::same_as<T, char8_t> &&
+                                   !std::same_as<T, char16_t> && !std::same_as<T, char32_t>;
+
+        // Integers of different signedness, which the built-in comparisons would convert to
+        // unsigned and <=> rejects; they compare by value instead.
+        template<typename L, typename R>
+        concept mixed_sign_integers = standard_integer<L> && standard_integer<R> &&
+                                      std::is_signed_v<L> != std::is_signed_v<R>;
+
+        template<typename L, typename R>
+        concept comparable_values = mixed_sign_integers<L, R> || std::three_way_comparable_with<L, R>;
+
+        // Compares without converting either side to the other's type first.
+        template<typename L, typename R>
+        constexpr auto compare_values(const L&lhs, const R&rhs) {
+            if constexpr (mixed_sign_integers<L, R>) {
+                return std::cmp_less(lhs, rhs) ? std::strong_ordering::less
+                       : std::cmp_equal(lhs, rhs) ? std::strong_ordering::equal
+                       : std::strong_ordering::greater;
+            } else {
+                return lhs <=> rhs;
+            }
+        }
+
+        template<typename L, typename R>
+        constexpr bool equal_values(const L&lhs, const R&rhs) {
+            if constexpr (mixed_sign_integers<L, R>) {
+                return std::cmp_equal(lhs, rhs);
+            } else {
+                return lhs == rhs;
+            }
+        }
+    } // namespace Internal
+
+    // An arithmetic attr for hot counters written by many threads. Each write lands in a
+    // cache-line sized shard picked by the writing CPU, so increments from different
+    // cores never contend; reads sum all shards and run the getter on the total.
+    //
+    // A read concurrent with writes sees some of them, like a relaxed load of a single
+    // atomic would. set() is meant for resets while writers are quiet.
+    template<typename T, typename Getter = default_getter<T>>
+        requires (std::integral<T> || std::floating_point<T>) && GetterFn<Getter, T>
+    class sharded_attr {
+    public:
+        using value_type = T;
+        using GetterType = Getter;
+        using result_type = std::remove_cvref_t<getter_result_t<Getter, value_type>>;
+
+        sharded_attr() : sharded_attr(T{}) {
+        }
+
+        explicit sharded_attr(T initial, std::size_t shards = Internal::default_shard_count())
+            : _mask(std::bit_ceil(shards) - 1), _shards(std::make_unique<shard[]>(_mask + 1)) {
+            _shards[0].value.store(initial, std::memory_order_relaxed);
+        }
+
+        sharded_attr(const sharded_attr&) = delete;
+        sharded_attr& operator=(const sharded_attr&) = delete;
+
+        // The sum of all shards.
+        T load() const noexcept {
+            T total{};
+            for (std::size_t i = 0; i <= _mask; ++i) {
+                total += _shards[i].value.load(std::memory_order_relaxed);
+            }
+            return total;
+        }
+
+        result_type get() const {
+            return std::invoke(_getter, load());
+        }
+
+        operator T() const requires std::convertible_to<result_type, T> { return get(); }
+
+        void set(T value) noexcept {
+            _shards[0].value.store(value, std::memory_order_relaxed);
+            for (std::size_t i = 1; i <= _mask; ++i) {
+                _shards[i].value.store(T{}, std::memory_order_relaxed);
+            }
+        }
+
+        sharded_attr& operator=(T value) noexcept {
+            set(value);
+            return *this;
+        }
+
+        // Writes return nothing: producing the new total would mean reading every shard.
+        void operator+=(T delta) noexcept {
+            _local().value.fetch_add(delta, std::memory_order_relaxed);
+        }
+
+        void operator-=(T delta) noexcept {
+            _local().value.fetch_sub(delta, std::memory_order_relaxed);
+        }
+
+        void operator++() noexcept { *this += T{1}; }
+
+        void operator--() noexcept { *this -= T{1}; }
+
+        void operator++(int) noexcept { *this += T{1}; }
+
+        void operator--(int) noexcept { *this -= T{1}; }
+
+        std::size_t shard_count() const noexcept { return _mask + 1; }
+
+        // Comparisons run on the aggregated get(), like attr_impl's.
+        auto operator<=>(const sharded_attr&rhs) const {
+            return get() <=> rhs.get();
+        }
+
+        // Templates, so that comparing with a literal of another arithmetic type picks these
+        // over the built-in comparison reached through operator T(). The operand is compared
+        // with get() as it is, never narrowed to T: sharded_attr<int>(2) < 2.5.
+        template<typename U>
+            requires (!std::same_as<U, sharded_attr>) && Internal::comparable_values<result_type, U>
+        auto operator<=>(const U&value) const {
+            return Internal::compare_values(get(), value);
+        }
+
+        bool operator==(const sharded_attr&rhs) const {
+            return get() == rhs.get();
+        }
+
+        template<typename U>
+            requires (!std::same_as<U, sharded_attr>) && Internal::comparable_values<result_type, U>
+        bool operator==(const U&value) const {
+            return Internal::equal_values(get(), value);
+        }
+
+    private:
+        struct alignas(64) shard {
+            std::atomic<T> value{};
+        };
+
+        shard& _local() noexcept {
+            return _shards[Internal::current_shard_hint() & _mask];
+        }
+
+        std::size_t _mask;
+        std::unique_ptr<shard[]> _shards;
+        ATTR_NO_UNIQUE_ADDRESS Getter _getter{};
+    };
+}
+
+#endif //SHARDED_ATTR_HPP
@@ -0,0 +1,507 @@
+#ifndef ATTR_SYNC_HPP
+#define ATTR_SYNC_HPP
+#include "attr.hpp"
+#include "futex.hpp"
+
+#include <atomic>
+#include <concepts>
+#include <coroutine>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <shared_mutex>
+#include <type_traits>
+#include <utility>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace touka {
+    namespace Internal {
+        // Spin-wait hint; keeps a waiting core from starving its hyperthread sibling.
+        inline void cpu_relax() noexcept {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+            _mm_pause();
+#elif defined(__x86_64__) || defined(__i386__)
+            _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+            asm volatile("yield" ::: "memory");
+#endif
+        }
+
+        // A trivially copyable value held as an array of relaxed atomic words. A reader may
+        // copy it while a writer replaces it: the copy can come out torn, which a seqlock's
+        // sequence check detects, but it is never a data race, and the loads and stores
+        // still compile to plain moves.
+        template<typename T>
+        class atomic_words {
+            static_assert(std::is_trivially_copyable_v<T>, "atomic_words requires a trivially copyable value");
+
+        public:
+            atomic_words() = default;
+
+            explicit atomic_words(const T&value) noexcept {
+                store(value);
+            }
+
+            atomic_words(const atomic_words&) = delete;
+            atomic_words& operator=(const atomic_words&) = delete;
+
+            // Copies the stored bytes to dest, which must have room for a T.
+            void load(void*dest) const noexcept {
+                word_type words[word_count];
+                for (std::size_t i = 0; i < word_count; ++i) {
+                    words[i] = _words[i].load(std::memory_order_relaxed);
+                }
+                std::memcpy(dest, words, sizeof(T));
+            }
+
+            void store(const T&value) noexcept {
+                word_type words[word_count]{};
+                std::memcpy(words, std::addressof(value), sizeof(T));
+                for (std::size_t i = 0; i < word_count; ++i) {
+                    _words[i].store(words[i], std::memory_order_relaxed);
+                }
+            }
+
+        private:
+            using word_type = std::uintptr_t;
+            static constexpr std::size_t word_count = (sizeof(T) + sizeof(word_type) - 1) / sizeof(word_type);
+
+            std::atomic<word_type> _words[word_count];
+        };
+
+        // A coroutine suspended until an attr changes. Lives in the awaiting coroutine's
+        // frame and is linked into the attr's waiter_list while suspended. state settles
+        // whether the parking thread or a writer goes on with it; see waiter_list::park().
+        struct change_waiter {
+            static constexpr std::uint32_t parking = 0;
+            static constexpr std::uint32_t parked = 1;
+            static constexpr std::uint32_t woken = 2;
+
+            change_waiter*next = nullptr;
+            change_waiter*prev = nullptr;
+            bool linked = false;
+            std::atomic<std::uint32_t> state{parking};
+            void (*wake)(change_waiter&) = nullptr;
+        };
+
+        // The coroutines suspended on one attr. Parking and removal take a spinlock; writers
+        // check for waiters with a single load and only lock when there are some.
+        class waiter_list {
+        public:
+            // Links waiter, then asks changed() whether the change it waits for has already
+            // happened; if so, unlinks it again unless a writer got to it first. A writer that
+            // unlinks the waiter while it is still parking only marks it woken and leaves it
+            // to this thread, so nothing else touches it until park() returns. Returns true
+            // once the waiter is handed to writers, after which the caller must not touch it:
+            // a writer may already be waking it. Returns false when the caller keeps it and
+            // should look at the value itself.
+            template<typename Changed>
+            bool park(change_waiter&waiter, Changed changed) {
+                _lock();
+                waiter.prev = _tail;
+                waiter.next = nullptr;
+                waiter.linked = true;
+                waiter.state.store(change_waiter::parking, std::memory_order_relaxed);
+                if (_tail) {
+                    _tail->next = &waiter;
+                } else {
+                    _head.store(&waiter, std::memory_order_seq_cst);
+                }
+                _tail = &waiter;
+                _unlock();
+                // Pairs with the writer publishing its change before looking for waiters.
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (changed()) {
+                    _lock();
+                    const bool still_linked = waiter.linked;
+                    if (still_linked) {
+                        _unlink(waiter);
+                    }
+                    _unlock();
+                    if (still_linked) {
+                        return false;
+                    }
+                }
+                // Fails if a writer unlinked the waiter and has already passed it by.
+                std::uint32_t expected = change_waiter::parking;
+                return waiter.state.compare_exchange_strong(expected, change_waiter::parked, std::memory_order_acq_rel,
+                                                            std::memory_order_acquire);
+            }
+
+            // For awaiters destroyed while suspended.
+            void remove(change_waiter&waiter) noexcept {
+                _lock();
+                if (waiter.linked) {
+                    _unlink(waiter);
+                }
+                _unlock();
+            }
+
+            // Wakes every linked waiter. Call after publishing a change, with no locks held. A
+            // woken waiter may park again, or be destroyed, from its wake function.
+            void wake_all() {
+                if (_head.load(std::memory_order_seq_cst) == nullptr) {
+                    return;
+                }
+                _lock();
+                change_waiter*waiter = _head.load(std::memory_order_relaxed);
+                for (change_waiter*node = waiter; node; node = node->next) {
+                    node->linked = false;
+                }
+                _head.store(nullptr, std::memory_order_relaxed);
+                _tail = nullptr;
+                _unlock();
+                while (waiter) {
+                    change_waiter*next = waiter->next;
+                    // A waiter still parking belongs to its park() call from here on.
+                    if (waiter->state.exchange(change_waiter::woken, std::memory_order_acq_rel) == change_waiter::parked) {
+                        waiter->wake(*waiter);
+                    }
+                    waiter = next;
+                }
+            }
+
+        private:
+            void _lock() noexcept {
+                while (_locked.test_and_set(std::memory_order_acquire)) {
+                    cpu_relax();
+                }
+            }
+
+            void _unlock() noexcept { _locked.clear(std::memory_order_release); }
+
+            void _unlink(change_waiter&waiter) noexcept {
+                if (waiter.prev) {
+                    waiter.prev->next = waiter.next;
+                } else {
+                    _head.store(waiter.next, std::memory_order_relaxed);
+                }
+                if (waiter.next) {
+                    waiter.next->prev = waiter.prev;
+                } else {
+                    _tail = waiter.prev;
+                }
+                waiter.linked = false;
+            }
+
+            std::atomic_flag _locked;
+            std::atomic<change_waiter *> _head{nullptr};
+            change_waiter*_tail = nullptr;
+        };
+
+        // What co_await attr.changed() and attr.until() suspend on for attrs that count their
+        // writes. Parks in the attr's waiter_list until the version moves on, then reads the
+        // value and, once predicate accepts it, resumes the coroutine through the executor.
+        template<typename Attr, typename Predicate, typename Executor>
+        class version_awaiter : change_waiter {
+        public:
+            using result_type = std::remove_cvref_t<decltype(std::declval<const Attr&>().get())>;
+
+            version_awaiter(const Attr&attr, waiter_list&waiters, Predicate predicate, Executor executor,
+                            bool check_first)
+                : _attr(&attr), _waiters(&waiters), _predicate(std::move(predicate)),
+                  _executor(std::move(executor)), _seen(attr.version()), _check_first(check_first) {
+                wake = &_wake;
+            }
+
+            version_awaiter(const version_awaiter&) = delete;
+            version_awaiter& operator=(const version_awaiter&) = delete;
+
+            ~version_awaiter() { _waiters->remove(*this); }
+
+            bool await_ready() { return _check_first && _accept(); }
+
+            bool await_suspend(std::coroutine_handle<> handle) {
+                _handle = handle;
+                // Once parked, a writer may resume the coroutine before this returns.
+                return _park();
+            }
+
+            result_type await_resume() { return std::move(*_value); }
+
+        private:
+            bool _accept() {
+                _seen = _attr->version();
+                _value.emplace(_attr->get());
+                return std::invoke(_predicate, std::as_const(*_value));
+            }
+
+            // Returns true if parked, false if the value was accepted without waiting.
+            bool _park() {
+                for (;;) {
+                    if (_waiters->park(*this, [this] { return _attr->version() != _seen; })) {
+                        return true;
+                    }
+                    if (_accept()) {
+                        return false;
+                    }
+                }
+            }
+
+            static void _wake(change_waiter&waiter) {
+                auto&self = static_cast<version_awaiter &>(waiter);
+                if (!self._accept() && self._park()) {
+                    return;
+                }
+                self._executor(self._handle);
+            }
+
+            const Attr*_attr;
+            waiter_list*_waiters;
+            ATTR_NO_UNIQUE_ADDRESS Predicate _predicate;
+            ATTR_NO_UNIQUE_ADDRESS Executor _executor;
+            std::uint64_t _seen;
+            bool _check_first;
+            std::optional<result_type> _value;
+            std::coroutine_handle<> _handle;
+        };
+    } // namespace Internal
+
+    // Synchronization policies for the fourth attr_impl parameter. A policy provides
+    // lock()/unlock() for writers and lock_shared()/unlock_shared() for readers, or read()
+    // when readers do not lock at all.
+    namespace sync {
+        // A test-and-test-and-set lock for short critical sections with cheap hooks. Readers
+        // take it exclusively too.
+        class spinlock {
+        public:
+            void lock() noexcept {
+                while (_locked.test_and_set(std::memory_order_acquire)) {
+                    while (_locked.test(std::memory_order_relaxed)) {
+                        Internal::cpu_relax();
+                    }
+                }
+            }
+
+            bool try_lock() noexcept { return !_locked.test_and_set(std::memory_order_acquire); }
+
+            void unlock() noexcept { _locked.clear(std::memory_order_release); }
+
+            void lock_shared() noexcept { lock(); }
+
+            void unlock_shared() noexcept { unlock(); }
+
+        private:
+            std::atomic_flag _locked;
+        };
+
+        // std::mutex; readers take it exclusively too.
+        class mutex {
+        public:
+            void lock() { _mutex.lock(); }
+
+            bool try_lock() { return _mutex.try_lock(); }
+
+            void unlock() { _mutex.unlock(); }
+
+            void lock_shared() { lock(); }
+
+            void unlock_shared() { unlock(); }
+
+        private:
+            std::mutex _mutex;
+        };
+
+        // std::shared_mutex; readers share the lock, for read-mostly attrs whose getters are
+        // expensive. Getters therefore run in several readers at once.
+        class shared_mutex {
+        public:
+            static constexpr bool shares_readers = true;
+
+            void lock() { _mutex.lock(); }
+
+            bool try_lock() { return _mutex.try_lock(); }
+
+            void unlock() { _mutex.unlock(); }
+
+            void lock_shared() { _mutex.lock_shared(); }
+
+            void unlock_shared() { _mutex.unlock_shared(); }
+
+        private:
+            std::shared_mutex _mutex;
+        };
+
+        // Readers never write shared memory: they copy the value and retry if a writer
+        // published meanwhile, then run the getter on the copy. Requires a trivially copyable
+        // value. Readers never touch the stored value itself: the attr keeps a second copy in
+        // atomic words, rewritten under the lock after each write, and read() copies that.
+        // Writers are serialized on the sequence counter itself, which also counts completed
+        // writes for version() and wait_for_change().
+        class seqlock {
+        public:
+            static constexpr bool publishes_value = true;
+            static constexpr bool shares_readers = true;
+
+            void lock() noexcept {
+                std::uint32_t seq = _seq.load(std::memory_order_relaxed);
+                for (;;) {
+                    if (!(seq & 1u) && _seq.compare_exchange_weak(seq, seq + 1, std::memory_order_acquire,
+                                                                  std::memory_order_relaxed)) {
+                        break;
+                    }
+                    Internal::cpu_relax();
+                    seq = _seq.load(std::memory_order_relaxed);
+                }
+                // Orders the odd sequence before the published stores for readers that see either.
+                std::atomic_thread_fence(std::memory_order_release);
+            }
+
+            // Threads blocked in wait_for_change() are only woken when there are some.
+            void unlock() noexcept {
+                _seq.store(_seq.load(std::memory_order_relaxed) + 1, std::memory_order_seq_cst);
+                Internal::futex_wake_waiters(_seq, _waiters);
+            }
+
+            template<typename T, typename F>
+            auto read(const Internal::atomic_words<T>&published, F&&fn) const {
+                alignas(T) unsigned char bytes[sizeof(T)];
+                for (;;) {
+                    const std::uint32_t before = _seq.load(std::memory_order_acquire);
+                    if (before & 1u) {
+                        Internal::cpu_relax();
+                        continue;
+                    }
+                    published.load(bytes);
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    if (_seq.load(std::memory_order_relaxed) == before) {
+                        return std::invoke(fn, *std::launder(reinterpret_cast<const T *>(bytes)));
+                    }
+                }
+            }
+
+            // Number of completed writes, modulo 2^31.
+            std::uint32_t version() const noexcept {
+                return _seq.load(std::memory_order_acquire) >> 1;
+            }
+
+            // Blocks until a write completes after the one that produced version. Waiters
+            // sleep on the sequence counter itself.
+            void wait_for_change(std::uint32_t version) const noexcept {
+                Internal::futex_wait_while(_seq, _waiters, [&] { return this->version() == version; });
+            }
+
+        private:
+            // Odd while a write is in progress.
+            std::atomic<std::uint32_t> _seq{0};
+            mutable std::atomic<std::uint32_t> _waiters{0};
+        };
+
+        // Counts writes so that readers can detect changes with one integer compare. The
+        // count goes up once per write of any kind (assignment, modify(), write(), compound
+        // operators, emplace(), swap()), after the write completes and before Inner is
+        // unlocked; a write whose hook throws still counts. Over sync::none the count is a
+        // plain integer and the attr stays unsynchronized; over a locking policy it is atomic,
+        // version() can be read without the lock and threads can block in wait_for_change().
+        template<typename Inner = none>
+        class versioned {
+        public:
+            static constexpr bool is_synchronized = Internal::SynchronizingPolicy<Inner>;
+            static constexpr bool publishes_value = Internal::PublishingPolicy<Inner>;
+            static constexpr bool shares_readers = Internal::SharedReadPolicy<Inner>;
+
+            constexpr void lock() {
+                if constexpr (is_synchronized) {
+                    _inner.lock();
+                }
+            }
+
+            constexpr bool try_lock() requires is_synchronized { return _inner.try_lock(); }
+
+            constexpr void unlock() {
+                if constexpr (is_synchronized) {
+                    unlock_deferring_resume();
+                    resume_awaiting();
+                } else {
+                    ++_version;
+                }
+            }
+
+            // unlock() in two steps, for callers that hold other locks: the write is counted,
+            // Inner released and blocked threads woken first, and the coroutines awaiting the
+            // attr are only resumed by resume_awaiting(), once every lock is released.
+            void unlock_deferring_resume() requires is_synchronized {
+                const std::uint64_t next = _version.load(std::memory_order_relaxed) + 1;
+                // seq_cst pairs with the fence in waiter_list::park(): either the parking
+                // coroutine sees this version or resume_awaiting() sees its waiter.
+                _version.store(next, std::memory_order_seq_cst);
+                _waiting.changes.store(static_cast<std::uint32_t>(next), std::memory_order_seq_cst);
+                _inner.unlock();
+                Internal::futex_wake_waiters(_waiting.changes, _waiting.waiters);
+            }
+
+            void resume_awaiting() const requires is_synchronized {
+                _waiting.coroutines.wake_all();
+            }
+
+            void lock_shared() requires is_synchronized && requires(Inner&inner) { inner.lock_shared(); } {
+                _inner.lock_shared();
+            }
+
+            void unlock_shared() requires is_synchronized && requires(Inner&inner) { inner.unlock_shared(); } {
+                _inner.unlock_shared();
+            }
+
+            template<typename T, typename F>
+                requires requires(const Inner&inner, const T&value, F&fn) { inner.read(value, fn); }
+            auto read(const T&value, F&&fn) const {
+                return _inner.read(value, fn);
+            }
+
+            constexpr std::uint64_t version() const noexcept {
+                if constexpr (is_synchronized) {
+                    return _version.load(std::memory_order_acquire);
+                } else {
+                    return _version;
+                }
+            }
+
+            // Blocks until a write completes after the one that produced version.
+            void wait_for_change(std::uint64_t version) const noexcept requires is_synchronized {
+                Internal::futex_wait_while(_waiting.changes, _waiting.waiters,
+                                           [&] { return this->version() == version; });
+            }
+
+            // The awaitables behind attr_impl::changed() and until(). Coroutines are resumed
+            // from the writer's unlock(), after Inner is released, and from swap() once both
+            // attrs are unlocked; an inline executor therefore runs them on the writing thread.
+            template<typename Attr, typename Executor>
+            auto changed(const Attr&attr, Executor executor) const requires is_synchronized {
+                return Internal::version_awaiter<Attr, Internal::accept_any, Executor>(
+                    attr, _waiting.coroutines, {}, std::move(executor), false);
+            }
+
+            template<typename Attr, typename Predicate, typename Executor>
+                requires is_synchronized && std::predicate<Predicate&, decltype(std::declval<const Attr&>().get())>
+            auto until(const Attr&attr, Predicate predicate, Executor executor) const {
+                return Internal::version_awaiter<Attr, Predicate, Executor>(
+                    attr, _waiting.coroutines, std::move(predicate), std::move(executor), true);
+            }
+
+        private:
+            // The low half of the count as a futex word, the number of threads asleep on it,
+            // and the coroutines suspended on the attr.
+            struct wait_state {
+                std::atomic<std::uint32_t> changes{0};
+                mutable std::atomic<std::uint32_t> waiters{0};
+                mutable Internal::waiter_list coroutines;
+            };
+
+            ATTR_NO_UNIQUE_ADDRESS Inner _inner;
+            std::conditional_t<is_synchronized, std::atomic<std::uint64_t>, std::uint64_t> _version{0};
+            ATTR_NO_UNIQUE_ADDRESS std::conditional_t<is_synchronized, wait_state, Internal::empty_slot> _waiting;
+        };
+    } // namespace sync
+}
+
+#endif //ATTR_SYNC_HPP
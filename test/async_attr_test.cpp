@@ -0,0 +1,278 @@
+//
+// Tests for async_attr.hpp.
+//
+
+#include <catch2/catch_all.hpp>
+#include "async_attr.hpp"
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace {
+	// Holds submitted drains until the test runs them, to control when delivery happens.
+	struct manual_executor
+	{
+		std::vector<std::function<void()>> tasks;
+
+		touka::change_dispatcher::executor_type submitter()
+		{
+			return [this](std::function<void()> task) { tasks.push_back(std::move(task)); };
+		}
+
+		void run()
+		{
+			auto pending = std::move(tasks);
+			tasks.clear();
+			for (auto& task : pending)
+				task();
+		}
+	};
+
+	// Runs every drain on a thread of its own, so a drain may start before the last one returned.
+	struct thread_executor
+	{
+		std::mutex mutex;
+		std::vector<std::thread> threads;
+
+		touka::change_dispatcher::executor_type submitter()
+		{
+			return [this](std::function<void()> task) {
+				std::lock_guard lock(mutex);
+				threads.emplace_back(std::move(task));
+			};
+		}
+
+		~thread_executor()
+		{
+			for (auto& thread : threads)
+				thread.join();
+		}
+	};
+
+	struct tagged
+	{
+		int producer;
+		int index;
+	};
+
+	struct record_setter
+	{
+		void operator()(int& value, const int& new_value) const { value = new_value * 10; }
+	};
+}
+
+TEST_CASE("mpsc_ring is bounded and FIFO", "[async_attr][mpsc_ring]")
+{
+	touka::Internal::mpsc_ring<int> ring(3);
+	CHECK(ring.capacity() == 4);
+	for (int i = 0; i < 4; ++i)
+		CHECK(ring.try_push(i));
+	CHECK_FALSE(ring.try_push(4));
+
+	int value = -1;
+	CHECK(ring.try_pop(value));
+	CHECK(value == 0);
+	CHECK(ring.try_push(4));
+	for (int expected = 1; expected <= 4; ++expected)
+	{
+		CHECK(ring.try_pop(value));
+		CHECK(value == expected);
+	}
+	CHECK_FALSE(ring.ready());
+	CHECK_FALSE(ring.try_pop(value));
+}
+
+TEST_CASE("mpsc_ring keeps each producer's order", "[async_attr][mpsc_ring]")
+{
+	constexpr int producers = 4;
+	constexpr int per_producer = 20000;
+	touka::Internal::mpsc_ring<tagged> ring(64);
+
+	std::vector<std::thread> threads;
+	for (int p = 0; p < producers; ++p)
+	{
+		threads.emplace_back([&ring, p] {
+			for (int i = 0; i < per_producer; ++i)
+				while (!ring.try_push(tagged{p, i}))
+					std::this_thread::yield();
+		});
+	}
+
+	std::vector<int> next(producers, 0);
+	bool ordered = true;
+	for (int received = 0; received < producers * per_producer;)
+	{
+		tagged item;
+		if (!ring.try_pop(item))
+		{
+			std::this_thread::yield();
+			continue;
+		}
+		ordered = ordered && item.index == next[item.producer];
+		++next[item.producer];
+		++received;
+	}
+	for (auto& thread : threads)
+		thread.join();
+
+	CHECK(ordered);
+	CHECK(next == std::vector<int>(producers, per_producer));
+}
+
+TEST_CASE("async_attr delivers changes on the dispatcher thread", "[async_attr]")
+{
+	touka::change_dispatcher dispatcher(16);
+	std::vector<int> seen;
+	std::thread::id consumer;
+	auto record = [&](const int& value) {
+		consumer = std::this_thread::get_id();
+		seen.push_back(value);
+	};
+
+	// The handler is held by reference, so a temporary that would dangle does not compile.
+	STATIC_REQUIRE_FALSE(std::is_constructible_v<touka::async_attr<int>, touka::change_dispatcher&, decltype(record)>);
+	STATIC_REQUIRE(std::is_constructible_v<touka::async_attr<int>, touka::change_dispatcher&, decltype(record)&>);
+
+	touka::async_attr<int> value(dispatcher, record);
+	std::vector<int> expected;
+	for (int i = 1; i <= 1000; ++i)
+	{
+		value = i;
+		expected.push_back(i);
+	}
+	value = 1000;  // Unchanged: nothing posted.
+	value += 1;
+	++value;
+	expected.push_back(1001);
+	expected.push_back(1002);
+	CHECK(value == 1002);
+
+	dispatcher.flush();
+	CHECK(seen == expected);
+	CHECK(consumer != std::this_thread::get_id());
+	CHECK(dispatcher.dropped() == 0);
+}
+
+TEST_CASE("async_attr delivers what the getter returns after the setter ran", "[async_attr]")
+{
+	touka::change_dispatcher dispatcher(8, [](std::function<void()> task) { task(); });
+	std::vector<int> seen;
+	auto record = [&seen](const int& value) { seen.push_back(value); };
+
+	touka::async_attr<int, touka::default_getter<int>, record_setter> value(dispatcher, record);
+	value = 3;
+	// An inline executor delivers before the write returns.
+	CHECK(seen == std::vector<int>{30});
+	CHECK(*value == 30);
+}
+
+TEST_CASE("async_attr drops changes when the queue is full", "[async_attr][backpressure]")
+{
+	manual_executor executor;
+	touka::change_dispatcher dispatcher(4, executor.submitter());
+	std::vector<int> seen;
+	auto record = [&seen](const int& value) { seen.push_back(value); };
+
+	{
+		touka::async_attr<int> value(dispatcher, record, touka::backpressure::drop);
+		for (int i = 1; i <= 10; ++i)
+			value = i;
+		CHECK(executor.tasks.size() == 1);
+		CHECK(dispatcher.dropped() == 6);
+
+		executor.run();
+		CHECK(seen == std::vector<int>{1, 2, 3, 4});
+
+		value = 11;
+		executor.run();
+	}
+	CHECK(seen == std::vector<int>{1, 2, 3, 4, 11});
+}
+
+TEST_CASE("async_attr coalesces changes", "[async_attr][backpressure]")
+{
+	manual_executor executor;
+	touka::change_dispatcher dispatcher(4, executor.submitter());
+	std::vector<int> seen;
+	auto record = [&seen](const int& value) { seen.push_back(value); };
+
+	touka::async_attr<int> first(dispatcher, record, touka::backpressure::coalesce);
+	touka::async_attr<int> second(dispatcher, record, touka::backpressure::coalesce, 0);
+	for (int i = 1; i <= 100; ++i)
+	{
+		first = i;
+		second = -i;
+	}
+	executor.run();
+	CHECK(seen == std::vector<int>{100, -100});
+	CHECK(dispatcher.dropped() == 0);
+
+	first = 101;
+	executor.run();
+	CHECK(seen == std::vector<int>{100, -100, 101});
+}
+
+TEST_CASE("async_attr blocks writers until there is room", "[async_attr][backpressure]")
+{
+	constexpr int writers = 4;
+	constexpr int writes = 2000;
+	touka::change_dispatcher dispatcher(2);
+
+	// Each counter is only touched by the consumer thread.
+	std::vector<int> counts(writers, 0);
+	std::vector<int> last(writers, 0);
+	std::vector<std::function<void(const int&)>> handlers;
+	for (int w = 0; w < writers; ++w)
+		handlers.emplace_back([&counts, &last, w](const int& value) {
+			++counts[w];
+			last[w] = value;
+		});
+
+	std::vector<std::thread> threads;
+	for (int w = 0; w < writers; ++w)
+	{
+		threads.emplace_back([&, w] {
+			touka::async_attr<int> value(dispatcher, handlers[w], touka::backpressure::block);
+			for (int i = 1; i <= writes; ++i)
+				value = i;
+		});
+	}
+	for (auto& thread : threads)
+		thread.join();
+
+	dispatcher.flush();
+	CHECK(counts == std::vector<int>(writers, writes));
+	CHECK(last == std::vector<int>(writers, writes));
+	CHECK(dispatcher.dropped() == 0);
+}
+
+TEST_CASE("async_attr delivers in order when executor drains overlap", "[async_attr][executor]")
+{
+	constexpr int writes = 2000;
+	thread_executor executor;
+	// Only the drain running at the time touches these.
+	int count = 0;
+	int last = 0;
+	bool ordered = true;
+	auto record = [&](const int& value) {
+		if (value <= last)
+			ordered = false;
+		last = value;
+		++count;
+	};
+	{
+		touka::change_dispatcher dispatcher(8, executor.submitter());
+		touka::async_attr<int> value(dispatcher, record, touka::backpressure::block);
+		for (int i = 1; i <= writes; ++i)
+			value = i;
+		dispatcher.flush();
+	}
+	CHECK(ordered);
+	CHECK(count == writes);
+	CHECK(last == writes);
+}
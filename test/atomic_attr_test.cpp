@@ -0,0 +1,189 @@
+//
+// Tests for atomic_attr.hpp.
+//
+
+#include <catch2/catch_all.hpp>
+#include "atomic_attr.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+	struct bounded_setter
+	{
+		void operator()(int& value, const int& new_value) const { value = std::clamp(new_value, 0, 1000); }
+	};
+
+	struct halving_getter
+	{
+		int operator()(const int& value) const { return value / 2; }
+	};
+
+	struct flag_setter
+	{
+		void operator()(unsigned& value, const unsigned& new_value) const { value = new_value; }
+		void after_modify(unsigned& value) const { value |= 0x80u; }
+	};
+
+	template<typename F>
+	void run_threads(unsigned count, F f)
+	{
+		std::vector<std::thread> threads;
+		for (unsigned i = 0; i < count; ++i)
+			threads.emplace_back(f);
+		for (auto& thread : threads)
+			thread.join();
+	}
+
+	constexpr unsigned thread_count = 4;
+	constexpr int iterations = 20000;
+}
+
+static_assert(sizeof(touka::atomic_attr<int>) == sizeof(std::atomic<int>));
+static_assert(sizeof(touka::atomic_attr<int, halving_getter, bounded_setter>) == sizeof(std::atomic<int>));
+static_assert(!std::is_copy_constructible_v<touka::atomic_attr<int>>);
+
+TEST_CASE("atomic_attr basic operations", "[atomic_attr]")
+{
+	touka::atomic_attr<int> a{5};
+	CHECK(a.get() == 5);
+	a = 7;
+	CHECK(static_cast<int>(a) == 7);
+	a.set(9, std::memory_order_release);
+	CHECK(a.load(std::memory_order_acquire) == 9);
+
+	CHECK((a += 3) == 12);
+	CHECK((a -= 2) == 10);
+	CHECK(++a == 11);
+	CHECK(a++ == 11);
+	CHECK(a-- == 12);
+	CHECK(--a == 10);
+	CHECK((a |= 0x10) == 0x1a);
+	CHECK((a &= 0x12) == 0x12);
+	CHECK((a ^= 0x02) == 0x10);
+	CHECK(a.modify([](int& v) { v *= 3; }) == 0x30);
+
+	touka::atomic_attr<double> d{1.5};
+	CHECK((d += 1.0) == 2.5);
+	CHECK(d++ == 2.5);
+	CHECK(d.get() == 3.5);
+}
+
+TEST_CASE("atomic_attr bool flags", "[atomic_attr]")
+{
+	// std::atomic<bool> has no fetch_or & co.; the operators fall back to modify().
+	touka::atomic_attr<bool> flag{false};
+	CHECK((flag |= true) == true);
+	CHECK((flag &= true) == true);
+	CHECK((flag ^= true) == false);
+	CHECK((flag |= false) == false);
+	flag = true;
+	CHECK((flag &= false) == false);
+	CHECK_FALSE(flag.get());
+}
+
+TEST_CASE("atomic_attr hooks", "[atomic_attr]")
+{
+	touka::atomic_attr<int, halving_getter, bounded_setter> a{10};
+	CHECK(a.get() == 5);
+	a = 5000;
+	CHECK(a.load() == 1000);
+	CHECK(a.get() == 500);
+	CHECK((a -= 3000) == 0);
+	CHECK(a-- == 0);
+	CHECK(a.load() == 0);
+
+	touka::atomic_attr<unsigned, touka::default_getter<unsigned>, flag_setter> f{1u};
+	CHECK(f.modify([](unsigned& v) { v += 1; }) == 0x82u);
+}
+
+TEST_CASE("atomic_attr under contention", "[atomic_attr]")
+{
+	SECTION("fetch operations lose no increments")
+	{
+		touka::atomic_attr<long> counter;
+		run_threads(thread_count, [&] {
+			for (int i = 0; i < iterations; ++i)
+				++counter;
+		});
+		CHECK(counter.get() == long{thread_count} * iterations);
+	}
+
+	SECTION("setters see every contended write")
+	{
+		touka::atomic_attr<int, touka::default_getter<int>, bounded_setter> bounded;
+		std::atomic<bool> out_of_range{false};
+		run_threads(thread_count, [&] {
+			for (int i = 0; i < iterations; ++i) {
+				int now = (bounded += 7);
+				if (now < 0 || now > 1000)
+					out_of_range = true;
+			}
+		});
+		CHECK_FALSE(out_of_range.load());
+		CHECK(bounded.get() == 1000);
+	}
+
+	SECTION("modify retries instead of losing updates")
+	{
+		touka::atomic_attr<int> product{0};
+		run_threads(thread_count, [&] {
+			for (int i = 0; i < iterations; ++i)
+				product.modify([](int& v) { v = v + 1; });
+		});
+		CHECK(product.get() == int{thread_count} * iterations);
+	}
+}
+
+TEST_CASE("atomic_ref_attr wraps existing storage", "[atomic_attr]")
+{
+	alignas(std::atomic_ref<long long>::required_alignment) long long raw = 40;
+	{
+		touka::atomic_ref_attr<long long> view{raw};
+		STATIC_REQUIRE(decltype(view)::wraps_existing);
+		CHECK(view.get() == 40);
+		run_threads(thread_count, [&] {
+			for (int i = 0; i < iterations; ++i)
+				view += 2;
+		});
+	}
+	CHECK(raw == 40 + 2LL * thread_count * iterations);
+}
+
+TEST_CASE("atomic_attr wait and notify", "[atomic_attr][wait]")
+{
+	SECTION("32-bit values block on a futex")
+	{
+		touka::atomic_attr<int> flag{0};
+		std::atomic<int> seen{-1};
+		std::thread waiter([&] {
+			flag.wait(0);
+			seen = flag.get();
+		});
+		std::this_thread::yield();
+		flag = 1;
+		flag.notify_all();
+		waiter.join();
+		CHECK(seen.load() == 1);
+	}
+
+	SECTION("other sizes use std::atomic::wait")
+	{
+		touka::atomic_attr<long long> generation{5};
+		std::thread waiter([&] { generation.wait(5, std::memory_order_acquire); });
+		std::this_thread::yield();
+		++generation;
+		generation.notify_one();
+		waiter.join();
+		CHECK(generation.get() == 6);
+	}
+
+	SECTION("waiting on a changed value returns at once")
+	{
+		touka::atomic_attr<float> level{1.5f};
+		level.wait(0.5f);
+		CHECK(level.get() == 1.5f);
+	}
+}
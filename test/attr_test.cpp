@@ -6,7 +6,14 @@
 #include <catch2/catch_all.hpp>
 #include "attr.hpp"
 
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <string_view>
 #include <utility>
+#include <vector>
 
 struct IntStruct
 {
@@ -89,7 +96,7 @@ bool move_test::was_moved = false;
 template <typename T>
 class forwarding_test
 {
-	attr::attr<T> _attr;
+	touka::attr_impl<T> _attr;
 
 public:
 	forwarding_test() : _attr() {}
@@ -119,17 +126,189 @@ struct assignment_test
 int assignment_test::num_objects_inited = 0;
 
 
+/////////////////////////////////////////////////////////////////////////////
+struct lifetime_counter
+{
+	lifetime_counter()                                          { ++default_constructions; }
+	explicit lifetime_counter(int v) noexcept : value(v)        { ++value_constructions; }
+	lifetime_counter(const lifetime_counter& o) : value(o.value) { ++copy_constructions; }
+	lifetime_counter(lifetime_counter&& o) noexcept : value(o.value) { ++move_constructions; }
+	lifetime_counter& operator=(const lifetime_counter& o)      { ++assignments; value = o.value; return *this; }
+	lifetime_counter& operator=(lifetime_counter&& o)           { ++assignments; value = o.value; return *this; }
+	lifetime_counter& operator=(int v)                          { ++assignments; value = v; return *this; }
+
+	friend auto operator<=>(const lifetime_counter&, const lifetime_counter&) = default;
+
+	static void reset() { default_constructions = value_constructions = copy_constructions = move_constructions = assignments = 0; }
+
+	static int default_constructions;
+	static int value_constructions;
+	static int copy_constructions;
+	static int move_constructions;
+	static int assignments;
+
+	int value = 0;
+};
+
+int lifetime_counter::default_constructions = 0;
+int lifetime_counter::value_constructions = 0;
+int lifetime_counter::copy_constructions = 0;
+int lifetime_counter::move_constructions = 0;
+int lifetime_counter::assignments = 0;
+
+/////////////////////////////////////////////////////////////////////////////
+struct identity_getter
+{
+	template <typename T>
+	const T& operator()(const T& value) const { return value; }
+};
+
+struct assign_setter
+{
+	template <typename T, typename U>
+	void operator()(T& value, U&& new_value) const { value = std::forward<U>(new_value); }
+};
+
+struct counting_setter
+{
+	template <typename T>
+	void operator()(T& value, const T& new_value) const { ++copies; value = new_value; }
+
+	template <typename T>
+	void operator()(T& value, T&& new_value) const { ++moves; value = std::move(new_value); }
+
+	static void reset() { copies = 0; moves = 0; }
+	static int copies;
+	static int moves;
+};
+
+int counting_setter::copies = 0;
+int counting_setter::moves = 0;
+
+struct clamping_setter
+{
+	static constexpr bool runs_on_construction = true;
+
+	void operator()(int& value, const int& new_value) const { ++calls; value = std::clamp(new_value, 0, 10); }
+
+	static int calls;
+};
+
+int clamping_setter::calls = 0;
+
+struct sorted_setter
+{
+	void operator()(std::vector<int>& value, const std::vector<int>& new_value) const { value = new_value; after_modify(value); }
+	void operator()(std::vector<int>& value, std::vector<int>&& new_value) const { value = std::move(new_value); after_modify(value); }
+	void after_modify(std::vector<int>& value) const { ++hook_calls; std::sort(value.begin(), value.end()); }
+
+	static int hook_calls;
+};
+
+int sorted_setter::hook_calls = 0;
+
+// Rejects negative elements from after_modify, to check that the hook is skipped when the
+// update itself throws.
+struct unsigned_elements_setter
+{
+	void operator()(std::vector<int>& value, const std::vector<int>& new_value) const { value = new_value; after_modify(value); }
+	void after_modify(std::vector<int>& value) const {
+		++hook_calls;
+		if (std::ranges::any_of(value, [](int v) { return v < 0; })) {
+			throw std::invalid_argument("negative element");
+		}
+	}
+
+	static int hook_calls;
+};
+
+int unsigned_elements_setter::hook_calls = 0;
+
+struct saturating_setter
+{
+	void operator()(int& value, const int& new_value) const { value = std::clamp(new_value, 0, 100); }
+
+	template <typename Op>
+	void update(int& value, Op&& op) const
+	{
+		++updates;
+		op(value);
+		value = std::clamp(value, 0, 100);
+	}
+
+	static int updates;
+};
+
+int saturating_setter::updates = 0;
+
+// Its update() takes only function pointers, which cannot carry a compound operator's
+// operand, so attrs ignore it and run the setter instead.
+struct pointer_update_setter
+{
+	void operator()(int& value, const int& new_value) const { ++sets; value = new_value; }
+	void update(int& value, void (*op)(int&)) const { op(value); }
+
+	static int sets;
+};
+
+int pointer_update_setter::sets = 0;
+
+struct scaled_getter
+{
+	int scale = 1;
+	int operator()(const int& value) const { return value * scale; }
+};
+
+struct view_getter
+{
+	std::string_view operator()(const std::string& value) const { return value; }
+};
+
+struct alignas(32) over_aligned
+{
+	float lanes[8];
+};
+
+constexpr auto lambda_getter = [](const auto& value) { return value; };
+constexpr auto lambda_setter = [](auto& value, const auto& new_value) { value = new_value; };
+
+template <typename Attr, typename T>
+constexpr bool has_value_layout = sizeof(Attr) == sizeof(T) && alignof(Attr) == alignof(T);
+
+template <typename T>
+constexpr bool has_zero_overhead_layout =
+	has_value_layout<touka::attr_impl<T>, T> &&
+	has_value_layout<touka::attr_impl<T, identity_getter, assign_setter>, T> &&
+	has_value_layout<touka::attr<T, lambda_getter, lambda_setter>, T> &&
+	has_value_layout<touka::attr<T, lambda_getter, lambda_setter, touka::sync::none>, T>;
+
+static_assert(has_zero_overhead_layout<char>);
+static_assert(has_zero_overhead_layout<short>);
+static_assert(has_zero_overhead_layout<int>);
+static_assert(has_zero_overhead_layout<long long>);
+static_assert(has_zero_overhead_layout<float>);
+static_assert(has_zero_overhead_layout<double>);
+static_assert(has_zero_overhead_layout<long double>);
+static_assert(has_zero_overhead_layout<void*>);
+static_assert(has_zero_overhead_layout<IntStruct>);
+static_assert(has_zero_overhead_layout<over_aligned>);
+static_assert(has_zero_overhead_layout<std::string>);
+
+static_assert(touka::attr_impl<int>::has_stateless_hooks);
+static_assert(!touka::attr_impl<int, scaled_getter>::has_stateless_hooks);
+static_assert(sizeof(touka::attr_impl<int, scaled_getter>) > sizeof(int));
+
 /////////////////////////////////////////////////////////////////////////////
 using namespace std;
 
 TEST_CASE("Optional Traits and Functionality", "[optional]") {
     SECTION("Type traits for optional") {
-        REQUIRE((std::is_same_v<attr::attr<int>::value_type, int>));
-        REQUIRE((std::is_same_v<attr::attr<short>::value_type, short>));
-        REQUIRE(!(std::is_same_v<attr::attr<short>::value_type, long>));
-        REQUIRE((std::is_same_v<attr::attr<const short>::value_type, const short>));
-        REQUIRE((std::is_same_v<attr::attr<volatile short>::value_type, volatile short>));
-        REQUIRE((std::is_same_v<attr::attr<const volatile short>::value_type, const volatile short>));
+        REQUIRE((std::is_same_v<touka::attr_impl<int>::value_type, int>));
+        REQUIRE((std::is_same_v<touka::attr_impl<short>::value_type, short>));
+        REQUIRE(!(std::is_same_v<touka::attr_impl<short>::value_type, long>));
+        REQUIRE((std::is_same_v<touka::attr_impl<const short>::value_type, const short>));
+        REQUIRE((std::is_same_v<touka::attr_impl<volatile short>::value_type, volatile short>));
+        REQUIRE((std::is_same_v<touka::attr_impl<const volatile short>::value_type, const volatile short>));
         #if EASTL_TYPE_TRAIT_is_literal_type_CONFORMANCE
             EASTL_INTERNAL_DISABLE_DEPRECATED() // 'is_literal_type<nullopt_t>': was declared deprecated
             REQUIRE(std::is_literal_type_v<nullopt_t>);
@@ -146,9 +325,9 @@ TEST_CASE("Optional Traits and Functionality", "[optional]") {
         SECTION("Not trivially destructible test") {
             struct NotTrivialDestructible { ~NotTrivialDestructible() = default; };
             REQUIRE(std::is_trivially_destructible_v<NotTrivialDestructible>);
-            REQUIRE(std::is_trivially_destructible_v<attr::attr<NotTrivialDestructible>>);
-            REQUIRE(std::is_trivially_destructible_v<attr::Internal::attr_storage<NotTrivialDestructible>>);
-            REQUIRE(std::is_trivially_destructible_v<attr::attr<NotTrivialDestructible>> == std::is_trivially_destructible_v<NotTrivialDestructible>);
+            REQUIRE(std::is_trivially_destructible_v<touka::attr_impl<NotTrivialDestructible>>);
+            REQUIRE(std::is_trivially_destructible_v<touka::Internal::attr_storage<NotTrivialDestructible>>);
+            REQUIRE(std::is_trivially_destructible_v<touka::attr_impl<NotTrivialDestructible>> == std::is_trivially_destructible_v<NotTrivialDestructible>);
         }
     }
     //
@@ -206,7 +385,7 @@ TEST_CASE("Optional Traits and Functionality", "[optional]") {
     // }
 
     SECTION("Move semantics with r-value ref and engaged attr") {
-        attr::attr uniPtrInt(make_unique<int>(42));
+        touka::attr_impl uniPtrInt(make_unique<int>(42));
     	unique_ptr<int> result = std::move(uniPtrInt);
 
         REQUIRE(result != nullptr);
@@ -215,6 +394,485 @@ TEST_CASE("Optional Traits and Functionality", "[optional]") {
     }
 }
 
+TEST_CASE("Zero-copy read path", "[attr][get]") {
+	SECTION("Identity getters return references") {
+		using string_attr = touka::attr_impl<std::string>;
+		STATIC_REQUIRE(string_attr::has_reference_getter);
+		STATIC_REQUIRE(std::is_same_v<decltype(std::declval<const string_attr&>().get()), const std::string&>);
+		STATIC_REQUIRE(std::is_same_v<decltype(*std::declval<const string_attr&>()), const std::string&>);
+		STATIC_REQUIRE(std::is_same_v<decltype(std::declval<const string_attr&>().operator->()), const std::string*>);
+		STATIC_REQUIRE(touka::attr_impl<std::vector<int>, identity_getter, assign_setter>::has_reference_getter);
+	}
+
+	SECTION("Value getters keep returning values") {
+		STATIC_REQUIRE(!touka::attr_impl<int, scaled_getter>::has_reference_getter);
+		STATIC_REQUIRE(std::is_same_v<decltype(std::declval<const touka::attr_impl<int, scaled_getter>&>().get()), int>);
+	}
+
+	SECTION("Reading does not copy the stored value") {
+		copy_test::was_copied = false;
+		const touka::attr_impl<copy_test> a{};
+		const copy_test& ref = a.get();
+		REQUIRE(&ref == &*a);
+		REQUIRE(&ref == a.operator->());
+		REQUIRE(!copy_test::was_copied);
+	}
+
+	SECTION("Getters may return views") {
+		const touka::attr_impl<std::string, view_getter> a(std::string("attribute"));
+		STATIC_REQUIRE(std::is_same_v<decltype(a.get()), std::string_view>);
+		REQUIRE(a.get() == "attribute");
+		REQUIRE(a->size() == 9);
+	}
+}
+
+TEST_CASE("Move semantics through the setter", "[attr][move]") {
+	SECTION("Moving an attr moves the value") {
+		touka::attr_impl<move_test> a;
+		move_test::was_moved = false;
+		touka::attr_impl<move_test> b(std::move(a));
+		REQUIRE(move_test::was_moved);
+
+		move_test::was_moved = false;
+		a = std::move(b);
+		REQUIRE(move_test::was_moved);
+
+		move_test::was_moved = false;
+		a = move_test{};
+		REQUIRE(move_test::was_moved);
+	}
+
+	SECTION("Move-only values transfer ownership") {
+		touka::attr_impl<std::unique_ptr<int>> a(std::make_unique<int>(7));
+		const int* raw = a->get();
+		touka::attr_impl<std::unique_ptr<int>> b(std::move(a));
+		REQUIRE(b->get() == raw);
+		REQUIRE(*a == nullptr);
+
+		a = std::move(b);
+		REQUIRE(a->get() == raw);
+		REQUIRE(*b == nullptr);
+	}
+
+	SECTION("Assigning from an lvalue copies and leaves the source intact") {
+		copy_test ct;
+		ct.value = 5;
+		touka::attr_impl<copy_test> a{};
+		copy_test::was_copied = false;
+		a = ct;
+		REQUIRE(copy_test::was_copied);
+		REQUIRE(a->value == 5);
+
+		std::string source = "keep";
+		touka::attr_impl<std::string> s;
+		s = source;
+		REQUIRE(source == "keep");
+		REQUIRE(*s == "keep");
+	}
+
+	SECTION("Custom setters receive rvalues") {
+		touka::attr_impl<std::string, touka::default_getter<std::string>, counting_setter> a;
+		touka::attr_impl<std::string, touka::default_getter<std::string>, counting_setter> b(std::string("value"));
+		counting_setter::reset();
+		a = std::move(b);
+		a = std::string("temporary");
+		REQUIRE(counting_setter::moves == 2);
+		REQUIRE(counting_setter::copies == 0);
+
+		a = b;
+		REQUIRE(counting_setter::copies == 1);
+	}
+}
+
+TEST_CASE("Copy and move construction build the value in place", "[attr][construct]") {
+	SECTION("Copies construct once without assigning") {
+		touka::attr_impl<lifetime_counter> a;
+		lifetime_counter::reset();
+		touka::attr_impl<lifetime_counter> b(a);
+		REQUIRE(lifetime_counter::copy_constructions == 1);
+		REQUIRE(lifetime_counter::default_constructions == 0);
+		REQUIRE(lifetime_counter::assignments == 0);
+
+		touka::attr_impl<lifetime_counter> c(std::move(b));
+		REQUIRE(lifetime_counter::move_constructions == 1);
+		REQUIRE(lifetime_counter::default_constructions == 0);
+		REQUIRE(lifetime_counter::assignments == 0);
+	}
+
+	SECTION("Value types need not be default constructible") {
+		STATIC_REQUIRE(!std::is_default_constructible_v<IntStruct>);
+		touka::attr_impl<IntStruct> a(IntStruct(3));
+		touka::attr_impl<IntStruct> b(a);
+		touka::attr_impl<IntStruct> c(std::move(b));
+		REQUIRE(c->data == 3);
+	}
+
+	SECTION("Setters may opt into running on construction") {
+		using clamped = touka::attr_impl<int, touka::default_getter<int>, clamping_setter>;
+		STATIC_REQUIRE(clamped::runs_setter_on_construction);
+		STATIC_REQUIRE(!touka::attr_impl<int>::runs_setter_on_construction);
+
+		clamping_setter::calls = 0;
+		clamped a(42);
+		REQUIRE(*a == 10);
+		clamped b(a);
+		REQUIRE(*b == 10);
+		REQUIRE(clamping_setter::calls == 2);
+	}
+}
+
+struct relocatable_handle
+{
+	explicit relocatable_handle(int v) : value(std::make_unique<int>(v)) {}
+	std::unique_ptr<int> value;
+};
+
+template <>
+struct touka::is_trivially_relocatable<relocatable_handle> : std::true_type {};
+
+TEST_CASE("Trivial copy and relocation", "[attr][trivial]") {
+	SECTION("Default hooks over trivial types are trivially copyable") {
+		STATIC_REQUIRE(std::is_trivially_copyable_v<touka::attr_impl<int>>);
+		STATIC_REQUIRE(std::is_trivially_copyable_v<touka::attr_impl<over_aligned>>);
+		STATIC_REQUIRE(std::is_trivially_copyable_v<touka::attr_impl<int, scaled_getter>>);
+		STATIC_REQUIRE(std::is_trivial_v<touka::attr_impl<double>>);
+		STATIC_REQUIRE(std::is_trivially_destructible_v<touka::attr_impl<int>>);
+	}
+
+	SECTION("Custom setters or non-trivial types keep user-defined copies") {
+		STATIC_REQUIRE(!std::is_trivially_copyable_v<touka::attr_impl<int, identity_getter, assign_setter>>);
+		STATIC_REQUIRE(!std::is_trivially_copyable_v<touka::attr_impl<std::string>>);
+		STATIC_REQUIRE(std::is_copy_constructible_v<touka::attr_impl<std::string>>);
+		STATIC_REQUIRE(std::is_nothrow_move_constructible_v<touka::attr_impl<std::string>>);
+	}
+
+	SECTION("Relocatability follows the value type and the hooks") {
+		STATIC_REQUIRE(touka::is_trivially_relocatable_v<touka::attr_impl<int>>);
+		STATIC_REQUIRE(touka::is_trivially_relocatable_v<touka::attr_impl<int, identity_getter, assign_setter>>);
+		STATIC_REQUIRE(touka::is_trivially_relocatable_v<touka::attr_impl<relocatable_handle>>);
+		STATIC_REQUIRE(!touka::is_trivially_relocatable_v<touka::attr_impl<std::string>>);
+	}
+
+	SECTION("uninitialized_relocate moves values into raw storage") {
+		using handle_attr = touka::attr_impl<relocatable_handle>;
+		alignas(handle_attr) unsigned char source[2 * sizeof(handle_attr)];
+		alignas(handle_attr) unsigned char target[2 * sizeof(handle_attr)];
+		auto* first = reinterpret_cast<handle_attr*>(source);
+		std::construct_at(first, relocatable_handle(1));
+		std::construct_at(first + 1, relocatable_handle(2));
+
+		auto* dest = reinterpret_cast<handle_attr*>(target);
+		REQUIRE(touka::uninitialized_relocate(first, first + 2, dest) == dest + 2);
+		REQUIRE(*dest[0]->value == 1);
+		REQUIRE(*dest[1]->value == 2);
+		std::destroy(dest, dest + 2);
+
+		alignas(std::string) unsigned char from[2 * sizeof(std::string)];
+		alignas(std::string) unsigned char to[2 * sizeof(std::string)];
+		auto* strings = reinterpret_cast<std::string*>(from);
+		std::construct_at(strings, "a");
+		std::construct_at(strings + 1, "b");
+		auto* moved = reinterpret_cast<std::string*>(to);
+		REQUIRE(touka::uninitialized_relocate(strings, strings + 2, moved) == moved + 2);
+		REQUIRE(moved[1] == "b");
+		std::destroy(moved, moved + 2);
+	}
+}
+
+constexpr auto doubling_getter = [](const int& value) { return value * 2; };
+constexpr auto non_negative_setter = [](int& value, const int& new_value) { value = new_value < 0 ? 0 : new_value; };
+using doubled_attr = touka::attr<int, doubling_getter, non_negative_setter>;
+
+constexpr int constexpr_round_trip()
+{
+	doubled_attr a(1);
+	doubled_attr b(a);
+	b = -4;
+	a = b;
+	doubled_attr c(std::move(a));
+	c = 3;
+	c.swap(b);
+	return static_cast<int>(b) * 100 + *c;
+}
+
+constexpr std::size_t constexpr_string_attr()
+{
+	touka::attr<std::string> name(std::string("attr"));
+	touka::attr<std::string> copy(name);
+	copy = std::string("attribute");
+	name.swap(copy);
+	return name->size() * 10 + copy->size();
+}
+
+static_assert(std::is_same_v<touka::attr<int>, touka::attr_impl<int>>);
+static_assert(constexpr_round_trip() == 600);
+static_assert(constexpr_string_attr() == 94);
+static_assert(doubled_attr(2) == 4);
+static_assert(doubled_attr(2) < doubled_attr(3));
+static_assert(touka::attr<int>(7).get() == 7);
+
+constinit doubled_attr constinit_table[] = {doubled_attr(1), doubled_attr(2), doubled_attr(3)};
+
+TEST_CASE("Constant evaluation", "[attr][constexpr]") {
+	REQUIRE(constinit_table[0] == 2);
+	REQUIRE(constinit_table[2] == 6);
+	constinit_table[1] = -1;
+	REQUIRE(*constinit_table[1] == 0);
+}
+
+TEST_CASE("Copy-free comparison, hashing and swap", "[attr][compare]") {
+	SECTION("Comparisons do not copy the stored values") {
+		const touka::attr_impl<lifetime_counter> a(lifetime_counter(1));
+		const touka::attr_impl<lifetime_counter> b(lifetime_counter(2));
+		const lifetime_counter one(1);
+		lifetime_counter::reset();
+		REQUIRE(a < b);
+		REQUIRE(a != b);
+		REQUIRE(a == one);
+		REQUIRE(one < b);
+		REQUIRE(std::is_gt(b <=> a));
+		REQUIRE(lifetime_counter::copy_constructions == 0);
+		REQUIRE(lifetime_counter::move_constructions == 0);
+	}
+
+	SECTION("Ordering category follows the value type") {
+		STATIC_REQUIRE(std::is_same_v<decltype(touka::attr<double>(1.0) <=> touka::attr<double>(2.0)), std::partial_ordering>);
+		STATIC_REQUIRE(std::is_same_v<decltype(touka::attr<int>(1) <=> touka::attr<int>(2)), std::strong_ordering>);
+	}
+
+	SECTION("Swap exchanges storage with default hooks") {
+		touka::attr<std::string> a(std::string(64, 'a'));
+		touka::attr<std::string> b(std::string(64, 'b'));
+		const char* a_data = a->data();
+		const char* b_data = b->data();
+		swap(a, b);
+		REQUIRE(a->data() == b_data);
+		REQUIRE(b->data() == a_data);
+	}
+
+	SECTION("Swap goes through custom setters") {
+		touka::attr_impl<std::string, touka::default_getter<std::string>, counting_setter> a(std::string("a"));
+		touka::attr_impl<std::string, touka::default_getter<std::string>, counting_setter> b(std::string("b"));
+		counting_setter::reset();
+		swap(a, b);
+		REQUIRE(*a == "b");
+		REQUIRE(*b == "a");
+		REQUIRE(counting_setter::moves == 2);
+		REQUIRE(counting_setter::copies == 0);
+	}
+
+	SECTION("Hashing matches the exposed value") {
+		const touka::attr<std::string> a(std::string("hash me"));
+		REQUIRE(std::hash<touka::attr<std::string>>{}(a) == std::hash<std::string>{}(*a));
+
+		const touka::attr_impl<std::string, view_getter> view(std::string("hash me"));
+		REQUIRE(std::hash<touka::attr_impl<std::string, view_getter>>{}(view) == std::hash<std::string_view>{}("hash me"));
+
+		std::unordered_set<touka::attr<std::string>> set;
+		set.insert(a);
+		REQUIRE(set.contains(touka::attr<std::string>(std::string("hash me"))));
+		STATIC_REQUIRE(!std::is_default_constructible_v<std::hash<touka::attr<over_aligned>>>);
+	}
+
+	SECTION("Sorting attrs orders by value") {
+		std::vector<touka::attr<std::string>> values;
+		for (const char* s : {"delta", "alpha", "charlie", "bravo"})
+			values.emplace_back(std::string(s));
+		std::sort(values.begin(), values.end());
+		REQUIRE(*values.front() == "alpha");
+		REQUIRE(*values.back() == "delta");
+	}
+}
+
+TEST_CASE("In-place modification", "[attr][modify]") {
+	SECTION("Default setters mutate the stored value directly") {
+		touka::attr<std::vector<int>> a;
+		STATIC_REQUIRE(touka::attr<std::vector<int>>::modifies_in_place);
+		a.modify([](std::vector<int>& v) { v.reserve(8); });
+		const int* data = a->data();
+		a.modify([](std::vector<int>& v) { v.push_back(1); });
+		{
+			auto writer = a.write();
+			writer->push_back(2);
+			(*writer).push_back(3);
+		}
+		REQUIRE(a->data() == data);
+		REQUIRE(*a == std::vector<int>{1, 2, 3});
+		REQUIRE(a.modify([](std::vector<int>& v) { return v.size(); }) == 3);
+	}
+
+	SECTION("after_modify hooks run once per scope") {
+		touka::attr_impl<std::vector<int>, touka::default_getter<std::vector<int>>, sorted_setter> a;
+		STATIC_REQUIRE(decltype(a)::modifies_in_place);
+		sorted_setter::hook_calls = 0;
+		{
+			auto writer = a.write();
+			writer->push_back(3);
+			writer->push_back(1);
+			writer->push_back(2);
+		}
+		REQUIRE(sorted_setter::hook_calls == 1);
+		REQUIRE(*a == std::vector<int>{1, 2, 3});
+
+		a.modify([](std::vector<int>& v) { v.push_back(0); });
+		REQUIRE(sorted_setter::hook_calls == 2);
+		REQUIRE(a->front() == 0);
+	}
+
+	SECTION("after_modify hooks are skipped when the update throws") {
+		touka::attr_impl<std::vector<int>, touka::default_getter<std::vector<int>>, unsigned_elements_setter> a;
+		unsigned_elements_setter::hook_calls = 0;
+		REQUIRE_THROWS_AS(a.modify([](std::vector<int>& v) { v.push_back(-1); throw std::runtime_error("update"); }),
+		                  std::runtime_error);
+		REQUIRE(unsigned_elements_setter::hook_calls == 0);
+		REQUIRE(*a == std::vector<int>{-1});
+
+		a.modify([](std::vector<int>& v) { v.clear(); });
+		REQUIRE(unsigned_elements_setter::hook_calls == 1);
+		REQUIRE_THROWS_AS(a.modify([](std::vector<int>& v) { v.push_back(-2); }), std::invalid_argument);
+		REQUIRE(unsigned_elements_setter::hook_calls == 2);
+	}
+
+	SECTION("Other setters see the modified copy exactly once") {
+		touka::attr_impl<std::string, touka::default_getter<std::string>, counting_setter> a(std::string("abc"));
+		STATIC_REQUIRE(!decltype(a)::modifies_in_place);
+		counting_setter::reset();
+		a.modify([](std::string& s) { s += "def"; s += "ghi"; });
+		REQUIRE(*a == "abcdefghi");
+		REQUIRE(counting_setter::moves == 1);
+		REQUIRE(counting_setter::copies == 0);
+	}
+
+	SECTION("A throwing update leaves the value untouched") {
+		touka::attr_impl<std::string, touka::default_getter<std::string>, counting_setter> a(std::string("abc"));
+		counting_setter::reset();
+		REQUIRE_THROWS(a.modify([](std::string& s) { s.clear(); throw 1; }));
+		REQUIRE(*a == "abc");
+		REQUIRE(counting_setter::moves == 0);
+	}
+}
+
+static_assert([] {
+	touka::attr<int> a(1);
+	++a;
+	a += 2;
+	a <<= 1;
+	return *a;
+}() == 8);
+
+TEST_CASE("Compound operators", "[attr][compound]") {
+	SECTION("Arithmetic and bitwise operators update the value") {
+		touka::attr<int> a(1);
+		REQUIRE(*++a == 2);
+		REQUIRE(a++ == 2);
+		REQUIRE(*a == 3);
+		REQUIRE(a-- == 3);
+		REQUIRE(*--a == 1);
+		a += 9;
+		a *= 3;
+		a -= 2;
+		a /= 4;
+		REQUIRE(*a == 7);
+		a %= 4;
+		a |= 8;
+		a &= 10;
+		a ^= 1;
+		REQUIRE(*a == 11);
+		a <<= 2;
+		a >>= 1;
+		REQUIRE(*a == 22);
+	}
+
+	SECTION("Operators forward to the value type") {
+		touka::attr<std::string> s(std::string("attr"));
+		s += "ibute";
+		s += std::string_view("s");
+		REQUIRE(*s == "attributes");
+	}
+
+	SECTION("update() hooks see every compound operation") {
+		touka::attr_impl<int, touka::default_getter<int>, saturating_setter> a(50);
+		saturating_setter::updates = 0;
+		a += 1000;
+		REQUIRE(*a == 100);
+		a -= 1000;
+		REQUIRE(*a == 0);
+		--a;
+		REQUIRE(*a == 0);
+		REQUIRE(saturating_setter::updates == 3);
+	}
+
+	SECTION("update() must accept capturing operations") {
+		STATIC_REQUIRE(touka::UpdateFn<saturating_setter, int>);
+		STATIC_REQUIRE_FALSE(touka::UpdateFn<pointer_update_setter, int>);
+		touka::attr_impl<int, touka::default_getter<int>, pointer_update_setter> a(1);
+		pointer_update_setter::sets = 0;
+		a += 2;
+		++a;
+		REQUIRE(*a == 4);
+		REQUIRE(pointer_update_setter::sets == 2);
+	}
+
+	SECTION("Other setters receive the updated value once") {
+		touka::attr_impl<int, touka::default_getter<int>, counting_setter> a(1);
+		counting_setter::reset();
+		a += 1;
+		++a;
+		REQUIRE(*a == 3);
+		REQUIRE(counting_setter::moves == 2);
+		REQUIRE(counting_setter::copies == 0);
+	}
+}
+
+TEST_CASE("Emplacement and heterogeneous assignment", "[attr][emplace]") {
+	SECTION("Default setters assign convertible values directly") {
+		touka::attr<lifetime_counter> a(lifetime_counter(1));
+		lifetime_counter::reset();
+		a = 5;
+		REQUIRE(a->value == 5);
+		REQUIRE(lifetime_counter::assignments == 1);
+		REQUIRE(lifetime_counter::value_constructions == 0);
+		REQUIRE(lifetime_counter::move_constructions == 0);
+
+		touka::attr<std::string> s;
+		s = "literal";
+		REQUIRE(*s == "literal");
+		s = std::string_view("view");
+		REQUIRE(*s == "view");
+	}
+
+	SECTION("Custom setters receive a constructed value by rvalue") {
+		touka::attr_impl<std::string, touka::default_getter<std::string>, counting_setter> s;
+		counting_setter::reset();
+		s = "literal";
+		s = std::string_view("view");
+		REQUIRE(*s == "view");
+		REQUIRE(counting_setter::moves == 2);
+		REQUIRE(counting_setter::copies == 0);
+	}
+
+	SECTION("emplace constructs in place") {
+		touka::attr<lifetime_counter> a(lifetime_counter(1));
+		lifetime_counter::reset();
+		REQUIRE(a.emplace(4).value == 4);
+		REQUIRE(lifetime_counter::value_constructions == 1);
+		REQUIRE(lifetime_counter::move_constructions == 0);
+		REQUIRE(lifetime_counter::assignments == 0);
+
+		touka::attr<std::vector<int>> v(std::in_place, {1, 2});
+		REQUIRE(v.emplace(3u, 7) == std::vector<int>{7, 7, 7});
+		REQUIRE(v.emplace({4, 5}) == std::vector<int>{4, 5});
+	}
+
+	SECTION("emplace goes through custom setters") {
+		touka::attr_impl<std::string, touka::default_getter<std::string>, counting_setter> s;
+		counting_setter::reset();
+		s.emplace(3u, 'x');
+		REQUIRE(*s == "xxx");
+		REQUIRE(counting_setter::moves == 1);
+	}
+}
+
 int main(int argc, char* argv[]) {
 	Catch::Session session;
 
@@ -0,0 +1,65 @@
+# Compiles SOURCE to assembly and checks that each function named in PAIRS compiles to the
+# same instructions with an attr as with the plain value: <name>_attr against <name>_int.
+#
+#   cmake -DCXX=<compiler> -DSOURCE=<file> -DINCLUDE_DIR=<dir> -DOUTPUT=<file.s>
+#         -DPAIRS=increment,add -P check_codegen.cmake
+
+foreach(variable CXX SOURCE INCLUDE_DIR OUTPUT PAIRS)
+  if(NOT DEFINED ${variable})
+    message(FATAL_ERROR "check_codegen.cmake: ${variable} is not set")
+  endif()
+endforeach()
+
+execute_process(
+  COMMAND "${CXX}" -std=c++20 -O2 -S -fno-asynchronous-unwind-tables -fno-exceptions
+          -I "${INCLUDE_DIR}" "${SOURCE}" -o "${OUTPUT}"
+  RESULT_VARIABLE result
+  ERROR_VARIABLE errors)
+if(NOT result EQUAL 0)
+  message(FATAL_ERROR "compiling ${SOURCE} failed:\n${errors}")
+endif()
+
+string(REPLACE "," ";" PAIRS "${PAIRS}")
+file(STRINGS "${OUTPUT}" assembly)
+
+# The instructions of one function: the lines after its label up to the next function,
+# without directives, local labels or comments.
+function(function_body name out)
+  set(body "")
+  set(inside FALSE)
+  foreach(line IN LISTS assembly)
+    if(line MATCHES "^_?${name}:")
+      set(inside TRUE)
+    elseif(inside)
+      if(line MATCHES "^[ \t]*\\.(size|globl|section|text|ident|p2align|align)" OR line MATCHES "^[_A-Za-z][_A-Za-z0-9]*:")
+        break()
+      endif()
+      if(NOT line MATCHES "^[ \t]*\\." AND NOT line MATCHES "^[ \t]*$" AND NOT line MATCHES "^\\.L" AND
+         NOT line MATCHES "^[ \t]*[#;@]")
+        string(STRIP "${line}" line)
+        list(APPEND body "${line}")
+      endif()
+    endif()
+  endforeach()
+  set(${out} "${body}" PARENT_SCOPE)
+endfunction()
+
+set(failures "")
+foreach(pair IN LISTS PAIRS)
+  function_body(${pair}_int plain)
+  function_body(${pair}_attr wrapped)
+  if(plain STREQUAL "")
+    list(APPEND failures "${pair}_int not found in ${OUTPUT}")
+  elseif(NOT plain STREQUAL wrapped)
+    string(REPLACE ";" "\n    " plain "${plain}")
+    string(REPLACE ";" "\n    " wrapped "${wrapped}")
+    list(APPEND failures "${pair}: int compiles to\n    ${plain}\n  but attr<int> to\n    ${wrapped}")
+  endif()
+endforeach()
+
+if(failures)
+  string(REPLACE ";" "\n" failures "${failures}")
+  message(FATAL_ERROR "attr codegen differs from the plain value:\n${failures}")
+endif()
+list(LENGTH PAIRS count)
+message(STATUS "${count} attr functions compile like their plain counterparts")
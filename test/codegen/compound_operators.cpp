@@ -0,0 +1,21 @@
+// Compiled to assembly by check_codegen.cmake, which requires every <name>_attr function
+// to compile to the same instructions as its <name>_int counterpart.
+
+#include "attr.hpp"
+
+extern "C" {
+    void increment_int(int&value) { ++value; }
+    void increment_attr(touka::attr<int>&value) { ++value; }
+
+    void decrement_int(int&value) { --value; }
+    void decrement_attr(touka::attr<int>&value) { --value; }
+
+    void add_int(int&value, int delta) { value += delta; }
+    void add_attr(touka::attr<int>&value, int delta) { value += delta; }
+
+    void shift_int(int&value, int bits) { value <<= bits; }
+    void shift_attr(touka::attr<int>&value, int bits) { value <<= bits; }
+
+    int post_increment_int(int&value) { return value++; }
+    int post_increment_attr(touka::attr<int>&value) { return value++; }
+}
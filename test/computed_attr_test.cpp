@@ -0,0 +1,119 @@
+//
+// Tests for computed_attr.hpp.
+//
+
+#include <catch2/catch_all.hpp>
+#include "computed_attr.hpp"
+
+#include <string>
+#include <vector>
+
+namespace {
+	struct length_getter
+	{
+		std::size_t operator()(const std::string& value) const { return value.size(); }
+	};
+}
+
+TEST_CASE("computed_attr computes lazily and memoizes", "[computed_attr]")
+{
+	touka::observable_attr<int> width(2);
+	touka::observable_attr<int> height(3);
+	int evaluations = 0;
+	touka::computed_attr<int> area([&evaluations](int w, int h) { ++evaluations; return w * h; }, width, height);
+
+	CHECK(evaluations == 0);
+	CHECK(area.stale());
+	CHECK(area == 6);
+	CHECK(*area == 6);
+	int value = area;
+	CHECK(value == 6);
+	CHECK(evaluations == 1);
+
+	width = 4;
+	height = 5;
+	CHECK(area.stale());
+	CHECK(evaluations == 1);
+	CHECK(area.get() == 20);
+	CHECK(evaluations == 2);
+
+	height = 5;  // Unchanged: stays memoized.
+	CHECK_FALSE(area.stale());
+	CHECK(area > 10);
+	CHECK(evaluations == 2);
+}
+
+TEST_CASE("computed_attr propagates staleness through a graph", "[computed_attr]")
+{
+	touka::observable_attr<int> base(1);
+	touka::observable_attr<int> unrelated(0);
+	std::vector<std::string> order;
+
+	touka::computed_attr<int> left([&order](int b) { order.push_back("left"); return b + 1; }, base);
+	touka::computed_attr<int> right([&order](int b) { order.push_back("right"); return b * 10; }, base);
+	touka::computed_attr<int> sum([&order](int l, int r) { order.push_back("sum"); return l + r; }, left, right);
+	touka::computed_attr<int> other([&order](int u) { order.push_back("other"); return u; }, unrelated);
+
+	CHECK(sum == 12);
+	CHECK(order == std::vector<std::string>{"left", "right", "sum"});
+
+	order.clear();
+	base = 2;
+	CHECK(left.stale());
+	CHECK(right.stale());
+	CHECK(sum.stale());
+	CHECK(other.stale());  // Never read yet.
+	CHECK(order.empty());
+
+	// Each node of the diamond is recomputed once, dependencies first.
+	CHECK(sum == 23);
+	CHECK(order == std::vector<std::string>{"left", "right", "sum"});
+
+	order.clear();
+	CHECK(other == 0);
+	unrelated = 1;
+	CHECK_FALSE(sum.stale());
+	CHECK(sum == 23);
+	CHECK(order == std::vector<std::string>{"other"});
+}
+
+TEST_CASE("computed_attr applies its getter", "[computed_attr]")
+{
+	touka::observable_attr<std::string> first("ada");
+	touka::observable_attr<std::string> last("lovelace");
+	touka::computed_attr<std::string, length_getter> length(
+		[](const std::string& f, const std::string& l) { return f + " " + l; }, first, last);
+
+	CHECK(length.get() == 12);
+	first = "augusta ada";
+	CHECK(length.get() == 20);
+}
+
+TEST_CASE("computed_attr unregisters from its dependencies", "[computed_attr]")
+{
+	touka::observable_attr<int> source(1);
+	{
+		touka::computed_attr<int> doubled([](int value) { return value * 2; }, source);
+		CHECK(doubled == 2);
+	}
+	source = 2;  // Would call into the destroyed computed_attr if it were still registered.
+	CHECK(source == 2);
+}
+
+TEST_CASE("computed_attr sees writes made inside a notification_batch", "[computed_attr][notification_batch]")
+{
+	touka::observable_attr<int> source(1);
+	touka::computed_attr<int> doubled([](int value) { return value * 2; }, source);
+	int calls = 0;
+	auto count = [&calls](const int&) { ++calls; };
+	source.subscribe(count);
+
+	CHECK(doubled == 2);
+	{
+		touka::notification_batch batch;
+		source = 5;
+		CHECK(calls == 0);
+		CHECK(doubled == 10);
+	}
+	CHECK(calls == 1);
+}
@@ -0,0 +1,308 @@
+//
+// Tests for memoized_getter.hpp.
+//
+
+#include <catch2/catch_all.hpp>
+#include "memoized_getter.hpp"
+#include "sync.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace {
+	int formats = 0;
+
+	// Stands in for an expensive getter and counts how often it runs.
+	struct format_getter
+	{
+		std::string operator()(const int& value) const
+		{
+			++formats;
+			return "#" + std::to_string(value);
+		}
+	};
+
+	int lengths = 0;
+
+	struct length_getter
+	{
+		std::size_t operator()(const std::string& value) const
+		{
+			++lengths;
+			return value.size();
+		}
+	};
+
+	bool fail_format = false;
+
+	struct failing_getter
+	{
+		int operator()(const int& value) const
+		{
+			if (fail_format)
+				throw std::runtime_error("format failed");
+			return value * 2;
+		}
+	};
+
+	struct clamp_setter
+	{
+		void operator()(int& value, const int& new_value) const { value = new_value; after_modify(value); }
+		void after_modify(int& value) const { value = value > 10 ? 10 : value; }
+	};
+
+	std::atomic<int> slow_formats{0};
+
+	// Slow enough that every reader of a burst arrives while the first one is still computing.
+	struct slow_format_getter
+	{
+		std::string operator()(const int& value) const
+		{
+			slow_formats.fetch_add(1, std::memory_order_relaxed);
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+			return "#" + std::to_string(value);
+		}
+	};
+
+	template<typename F>
+	void run_threads(unsigned count, F f)
+	{
+		std::vector<std::thread> threads;
+		for (unsigned i = 0; i < count; ++i)
+			threads.emplace_back([&f, i] { f(i); });
+		for (auto& thread : threads)
+			thread.join();
+	}
+
+	using lazy_format = touka::memoized_getter<int, format_getter>;
+	using eager_format = touka::memoized_getter<int, format_getter, touka::memoize::eager>;
+
+	template<typename Getter, typename Sync>
+	concept forms_attr = requires { typename touka::attr_impl<int, Getter, touka::default_setter<int>, Sync>; };
+}
+
+TEST_CASE("memoized_getter lazy computes on the first read after a write", "[memoized_getter]")
+{
+	STATIC_REQUIRE(touka::attr_impl<int, lazy_format>::has_write_hook);
+	STATIC_REQUIRE(touka::attr_impl<int, lazy_format>::has_reference_getter);
+	STATIC_REQUIRE_FALSE(touka::attr_impl<int>::has_write_hook);
+
+	formats = 0;
+	touka::attr_impl<int, lazy_format> value(1);
+	CHECK(formats == 0);
+	CHECK(*value == "#1");
+	CHECK(value.get() == "#1");
+	CHECK(value->size() == 2);
+	CHECK(&value.get() == &*value);
+	CHECK(formats == 1);
+
+	value = 2;
+	value = 3;  // Overwritten unread: never formatted.
+	CHECK(formats == 1);
+	CHECK(*value == "#3");
+	CHECK(formats == 2);
+
+	value += 4;
+	CHECK(*value == "#7");
+	++value;
+	CHECK(*value == "#8");
+	value.modify([](int& v) { v *= 2; });
+	CHECK(*value == "#16");
+	value.emplace(5);
+	CHECK(formats == 6);
+	*value.write() = 6;
+	CHECK(*value == "#6");
+	CHECK(formats == 7);
+}
+
+TEST_CASE("memoized_getter eager computes on write", "[memoized_getter]")
+{
+	formats = 0;
+	touka::attr_impl<int, eager_format> value(1);
+	CHECK(*value == "#1");
+	CHECK(formats == 1);
+
+	value = 2;
+	CHECK(formats == 2);
+	for (int i = 0; i < 3; ++i)
+		CHECK(*value == "#2");
+	CHECK(formats == 2);
+
+	value++;
+	value -= 1;
+	CHECK(formats == 4);
+	CHECK(*value == "#2");
+	CHECK(formats == 4);
+}
+
+TEST_CASE("memoized_getter follows copies, moves and swaps", "[memoized_getter]")
+{
+	touka::attr_impl<int, lazy_format> first(1);
+	touka::attr_impl<int, lazy_format> second(2);
+	CHECK(*first == "#1");
+	CHECK(*second == "#2");
+
+	first.swap(second);
+	CHECK(*first == "#2");
+	CHECK(*second == "#1");
+
+	touka::attr_impl<int, lazy_format> copy(first);
+	CHECK(*copy == "#2");
+	copy = second;
+	CHECK(*copy == "#1");
+
+	touka::attr_impl<int, lazy_format> moved(std::move(first));
+	CHECK(*moved == "#2");
+	moved = std::move(second);
+	CHECK(*moved == "#1");
+}
+
+TEST_CASE("memoized_getter does not compute for moved-from values", "[memoized_getter]")
+{
+	using eager_length = touka::memoized_getter<std::string, length_getter, touka::memoize::eager>;
+	STATIC_REQUIRE(std::is_nothrow_move_constructible_v<touka::attr_impl<std::string, eager_length>>);
+	STATIC_REQUIRE(std::is_nothrow_move_constructible_v<touka::attr_impl<std::string, touka::memoized_getter<std::string,
+		length_getter>>>);
+	STATIC_REQUIRE(std::is_nothrow_move_constructible_v<touka::attr_impl<int, eager_format>>);
+
+	lengths = 0;
+	touka::attr_impl<std::string, eager_length> name(std::string("touka"));
+	CHECK(*name == 5);
+	name = std::string("attr");
+	CHECK(lengths == 2);
+
+	touka::attr_impl<std::string, eager_length> moved(std::move(name));
+	CHECK(lengths == 2);
+	CHECK(*moved == 4);
+	CHECK(lengths == 3);
+
+	// Growing a vector moves every element without running the getter.
+	std::vector<touka::attr_impl<std::string, eager_length>> names;
+	names.reserve(1);
+	for (int i = 0; i < 8; ++i)
+		names.emplace_back(std::string(static_cast<std::size_t>(i), 'x'));
+	CHECK(lengths == 3);
+	CHECK(*names[7] == 7);
+	CHECK(lengths == 4);
+}
+
+TEST_CASE("memoized_getter sees values as the setter leaves them", "[memoized_getter]")
+{
+	touka::attr_impl<int, touka::memoized_getter<int, format_getter, touka::memoize::eager>, clamp_setter> level(3);
+	CHECK(*level == "#3");
+	level = 20;
+	CHECK(*level == "#10");
+	level.modify([](int& v) { v = 4; });
+	CHECK(*level == "#4");
+	level += 30;
+	CHECK(*level == "#10");
+}
+
+TEST_CASE("memoized_getter works under a locking policy", "[memoized_getter]")
+{
+	touka::attr_impl<int, eager_format, touka::default_setter<int>, touka::sync::mutex> value(1);
+	CHECK(value.get() == "#1");
+	value = 2;
+	value += 3;
+	CHECK(value.get() == "#5");
+}
+
+TEST_CASE("memoized_getter is rejected where readers overlap", "[memoized_getter]")
+{
+	STATIC_REQUIRE(forms_attr<lazy_format, touka::sync::none>);
+	STATIC_REQUIRE(forms_attr<lazy_format, touka::sync::spinlock>);
+	STATIC_REQUIRE(forms_attr<eager_format, touka::sync::mutex>);
+	STATIC_REQUIRE(forms_attr<lazy_format, touka::sync::versioned<touka::sync::mutex>>);
+	STATIC_REQUIRE_FALSE(forms_attr<lazy_format, touka::sync::shared_mutex>);
+	STATIC_REQUIRE_FALSE(forms_attr<eager_format, touka::sync::shared_mutex>);
+	STATIC_REQUIRE_FALSE(forms_attr<lazy_format, touka::sync::seqlock>);
+	STATIC_REQUIRE_FALSE(forms_attr<lazy_format, touka::sync::versioned<touka::sync::shared_mutex>>);
+	STATIC_REQUIRE(forms_attr<format_getter, touka::sync::shared_mutex>);
+}
+
+TEST_CASE("memoized_getter eager recomputes on the next read after a getter throws", "[memoized_getter]")
+{
+	touka::attr_impl<int, touka::memoized_getter<int, failing_getter, touka::memoize::eager>> value(1);
+	CHECK(*value == 2);
+
+	fail_format = true;
+	CHECK_THROWS_AS(value = 5, std::runtime_error);
+	fail_format = false;
+	CHECK(*value == 10);
+}
+
+TEST_CASE("concurrent_memoized_getter computes once per version", "[memoized_getter][concurrent]")
+{
+	using shared_format = touka::concurrent_memoized_getter<int, slow_format_getter>;
+	STATIC_REQUIRE(touka::attr_impl<int, shared_format>::has_write_hook);
+
+	touka::attr_impl<int, shared_format, touka::default_setter<int>, touka::sync::shared_mutex> value(0);
+	constexpr unsigned readers = 8;
+	slow_formats = 0;
+	for (int round = 1; round <= 3; ++round) {
+		value = round;
+		std::vector<std::string> seen(readers);
+		run_threads(readers, [&](unsigned index) { seen[index] = value.get(); });
+		CHECK(slow_formats == round);
+		for (const auto& result : seen)
+			CHECK(result == "#" + std::to_string(round));
+	}
+	CHECK(value.get() == "#3");
+	CHECK(slow_formats == 3);
+}
+
+TEST_CASE("concurrent_memoized_getter is rejected where readers take no lock", "[memoized_getter][concurrent]")
+{
+	using shared_format = touka::concurrent_memoized_getter<int, format_getter>;
+	STATIC_REQUIRE(forms_attr<shared_format, touka::sync::shared_mutex>);
+	STATIC_REQUIRE(forms_attr<shared_format, touka::sync::versioned<touka::sync::shared_mutex>>);
+	STATIC_REQUIRE(forms_attr<shared_format, touka::sync::mutex>);
+	STATIC_REQUIRE_FALSE(forms_attr<shared_format, touka::sync::seqlock>);
+	STATIC_REQUIRE_FALSE(forms_attr<shared_format, touka::sync::versioned<touka::sync::seqlock>>);
+}
+
+TEST_CASE("concurrent_memoized_getter keeps up with writers", "[memoized_getter][concurrent]")
+{
+	touka::attr_impl<int, touka::concurrent_memoized_getter<int, format_getter>, touka::default_setter<int>,
+		touka::sync::shared_mutex> value(0);
+	constexpr int writes = 2000;
+	std::atomic<bool> done{false};
+	std::atomic<bool> ordered{true};
+
+	formats = 0;
+	std::thread writer([&] {
+		for (int i = 1; i <= writes; ++i)
+			value = i;
+		done = true;
+	});
+	run_threads(4, [&](unsigned) {
+		int last = 0;
+		while (!done) {
+			const int seen = std::stoi(value.get().substr(1));
+			if (seen < last)
+				ordered = false;
+			last = seen;
+		}
+	});
+	writer.join();
+	CHECK(ordered);
+	CHECK(value.get() == "#" + std::to_string(writes));
+}
+
+TEST_CASE("concurrent_memoized_getter retries after the getter throws", "[memoized_getter][concurrent]")
+{
+	touka::attr_impl<int, touka::concurrent_memoized_getter<int, failing_getter>, touka::default_setter<int>,
+		touka::sync::shared_mutex> value(1);
+	fail_format = true;
+	CHECK_THROWS_AS(value.get(), std::runtime_error);
+	fail_format = false;
+	CHECK(value.get() == 2);
+	value = 4;
+	CHECK(value.get() == 8);
+}
@@ -0,0 +1,623 @@
+//
+// Tests for observable_attr.hpp and function_ref.hpp.
+//
+
+#include <catch2/catch_all.hpp>
+#include "observable_attr.hpp"
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+	// Counts allocations made through counting_allocator while enabled, to prove that
+	// paths do not allocate.
+	bool count_allocations = false;
+	int allocations = 0;
+
+	template<typename T>
+	struct counting_allocator
+	{
+		using value_type = T;
+
+		counting_allocator() = default;
+		template<typename U>
+		counting_allocator(const counting_allocator<U>&) noexcept {}
+
+		T* allocate(std::size_t n)
+		{
+			if (count_allocations)
+				++allocations;
+			return std::allocator<T>().allocate(n);
+		}
+
+		void deallocate(T* p, std::size_t n) noexcept { std::allocator<T>().deallocate(p, n); }
+
+		friend bool operator==(const counting_allocator&, const counting_allocator&) = default;
+	};
+
+	template<std::size_t InlineSubscribers = 4>
+	using counted_observable = touka::observable_attr<int, touka::default_getter<int>, touka::default_setter<int>,
+		InlineSubscribers, counting_allocator<std::byte>>;
+
+	struct clamp_setter
+	{
+		void operator()(int& value, const int& new_value) const { value = new_value > 10 ? 10 : new_value; }
+	};
+
+	int free_function_calls = 0;
+	void free_function(const int&) { ++free_function_calls; }
+
+	// An eagerly started coroutine that stays suspended at its end, so tests can check done().
+	struct watcher
+	{
+		struct promise_type
+		{
+			watcher get_return_object() { return watcher(std::coroutine_handle<promise_type>::from_promise(*this)); }
+			std::suspend_never initial_suspend() noexcept { return {}; }
+			std::suspend_always final_suspend() noexcept { return {}; }
+			void return_void() {}
+			void unhandled_exception() { std::terminate(); }
+		};
+
+		explicit watcher(std::coroutine_handle<promise_type> h) : handle(h) {}
+		watcher(watcher&& other) noexcept : handle(std::exchange(other.handle, {})) {}
+		~watcher()
+		{
+			if (handle)
+				handle.destroy();
+		}
+
+		bool done() const { return handle.done(); }
+
+		std::coroutine_handle<promise_type> handle;
+	};
+
+	// Resumes coroutines only when the test says so.
+	struct queue_executor
+	{
+		std::vector<std::coroutine_handle<>>* queue;
+
+		void operator()(std::coroutine_handle<> handle) const { queue->push_back(handle); }
+	};
+
+	watcher record_changes(touka::observable_attr<int>& value, std::vector<int>& seen, int count)
+	{
+		for (int i = 0; i < count; ++i)
+			seen.push_back(co_await value.changed());
+	}
+
+	template<typename Observable>
+	watcher count_changes(Observable& value, int& changes, int count)
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			co_await value.changed();
+			++changes;
+		}
+	}
+
+	watcher wait_until_above(touka::observable_attr<int>& value, int limit, int& result)
+	{
+		result = co_await value.until([limit](const int& v) { return v > limit; });
+	}
+
+	template<typename Attr, typename Callback>
+	concept can_subscribe = requires(Attr& attr, Callback&& callback) { attr.subscribe(std::forward<Callback>(callback)); };
+
+	template<typename Attr, typename Callback>
+	concept can_add_dependent = requires(Attr& attr, Callback&& callback) {
+		attr.add_dependent(std::forward<Callback>(callback));
+	};
+
+	watcher record_on(touka::observable_attr<int>& value, queue_executor executor, std::vector<int>& seen)
+	{
+		seen.push_back(co_await value.changed(executor));
+	}
+}
+
+TEST_CASE("function_ref", "[observable_attr][function_ref]")
+{
+	int total = 0;
+	auto add = [&total](int value) { total += value; };
+	touka::function_ref<void(int)> ref(add);
+	ref(2);
+	ref(3);
+	CHECK(total == 5);
+
+	touka::function_ref<void(const int&)> fn(free_function);
+	fn(1);
+	CHECK(free_function_calls == 1);
+
+	touka::function_ref<int(int)> doubled([](int value) { return value * 2; });
+	CHECK(doubled(4) == 8);
+	STATIC_REQUIRE(std::is_trivially_copyable_v<touka::function_ref<void(int)>>);
+}
+
+TEST_CASE("function_ref rejects temporaries that would dangle", "[observable_attr][function_ref]")
+{
+	int total = 0;
+	auto add = [&total](const int& value) { total += value; };
+	auto invalidate = [&total] { ++total; };
+	auto log = [](const int&) {};
+	using observable = touka::observable_attr<int>;
+
+	STATIC_REQUIRE(std::is_constructible_v<touka::function_ref<void(const int&)>, decltype(add)&>);
+	STATIC_REQUIRE_FALSE(std::is_constructible_v<touka::function_ref<void(const int&)>, decltype(add)>);
+	STATIC_REQUIRE_FALSE(std::is_constructible_v<touka::function_ref<void(const int&)>, std::function<void(const int&)>>);
+
+	STATIC_REQUIRE(can_subscribe<observable, decltype(add)&>);
+	STATIC_REQUIRE(can_subscribe<observable, decltype(log)>);
+	STATIC_REQUIRE(can_subscribe<observable, void (&)(const int&)>);
+	STATIC_REQUIRE_FALSE(can_subscribe<observable, decltype(add)>);
+	STATIC_REQUIRE_FALSE(can_subscribe<observable, std::function<void(const int&)>>);
+	STATIC_REQUIRE(can_add_dependent<observable, decltype(invalidate)&>);
+	STATIC_REQUIRE_FALSE(can_add_dependent<observable, decltype(invalidate)>);
+
+	observable value(0);
+	value.subscribe(add);
+	value.subscribe(log);
+	value.subscribe([](const int&) {});
+	value = 3;
+	CHECK(total == 3);
+}
+
+TEST_CASE("observable_attr notifies on changes", "[observable_attr]")
+{
+	touka::observable_attr<std::string> name("ada");
+	std::vector<std::string> seen;
+	auto record = [&seen](const std::string& value) { seen.push_back(value); };
+
+	auto id = name.subscribe(record);
+	CHECK(name.subscriber_count() == 1);
+
+	name = "grace";
+	name = "grace";  // Unchanged: no notification.
+	name.modify([](std::string& value) { value += "!"; });
+	name += "?";
+	name.emplace(2, 'x');
+	CHECK(seen == std::vector<std::string>{"grace", "grace!", "grace!?", "xx"});
+	CHECK(*name == "xx");
+	CHECK(name == "xx");
+	CHECK(name->size() == 2);
+
+	CHECK(name.unsubscribe(id));
+	CHECK_FALSE(name.unsubscribe(id));
+	name = "hopper";
+	CHECK(seen.size() == 4);
+}
+
+TEST_CASE("observable_attr compares what the getter returns", "[observable_attr]")
+{
+	touka::observable_attr<int, touka::default_getter<int>, clamp_setter> level(0);
+	int calls = 0;
+	auto count = [&calls](const int&) { ++calls; };
+	level.subscribe(count);
+
+	level = 20;
+	level = 30;  // Clamped to the same 10.
+	++level;     // Still 10.
+	--level;
+	CHECK(*level == 9);
+	CHECK(calls == 2);
+}
+
+TEST_CASE("observable_attr subscribers can change subscriptions while notified", "[observable_attr]")
+{
+	touka::observable_attr<int> value(0);
+	std::vector<int> order;
+	touka::observable_attr<int>::subscription first = 0;
+	touka::observable_attr<int>::subscription late = 0;
+
+	auto late_callback = [&order](const int&) { order.push_back(3); };
+	auto first_callback = [&](const int&) {
+		order.push_back(1);
+		value.unsubscribe(first);
+		late = value.subscribe(late_callback);
+	};
+	auto second_callback = [&order](const int&) { order.push_back(2); };
+
+	first = value.subscribe(first_callback);
+	value.subscribe(second_callback);
+
+	value = 1;
+	CHECK(order == std::vector<int>{1, 2});
+	CHECK(value.subscriber_count() == 2);
+
+	order.clear();
+	value = 2;
+	CHECK(order == std::vector<int>{2, 3});
+	CHECK(value.unsubscribe(late));
+}
+
+TEST_CASE("observable_attr recognises stale subscriptions", "[observable_attr]")
+{
+	touka::observable_attr<int> value(0);
+	int first_calls = 0, second_calls = 0;
+	auto first_callback = [&first_calls](const int&) { ++first_calls; };
+	auto second_callback = [&second_calls](const int&) { ++second_calls; };
+
+	auto first = value.subscribe(first_callback);
+	CHECK(first != 0);
+	CHECK(value.subscribed(first));
+	CHECK(value.unsubscribe(first));
+	CHECK_FALSE(value.subscribed(first));
+
+	// Takes over the slot first had, under a new generation.
+	auto second = value.subscribe(second_callback);
+	CHECK(second != first);
+	CHECK_FALSE(value.unsubscribe(first));
+	CHECK_FALSE(value.subscribed(first));
+	CHECK(value.subscribed(second));
+	CHECK_FALSE(value.subscribed(0));
+	CHECK_FALSE(value.unsubscribe(0));
+
+	value = 1;
+	CHECK(first_calls == 0);
+	CHECK(second_calls == 1);
+}
+
+TEST_CASE("observable_attr keeps subscription order across unsubscribes", "[observable_attr]")
+{
+	touka::observable_attr<int> value(0);
+	std::vector<int> order;
+	struct recorder
+	{
+		std::vector<int>* order;
+		int index;
+		void operator()(const int&) const { order->push_back(index); }
+	};
+	std::vector<recorder> recorders;
+	for (int i = 0; i < 300; ++i)
+		recorders.push_back(recorder{&order, i});
+	std::vector<touka::observable_attr<int>::subscription> ids;
+	for (auto& callback : recorders)
+		ids.push_back(value.subscribe(callback));
+
+	std::vector<int> expected;
+	for (int i = 299; i >= 0; --i) {
+		if (i % 3 == 0)
+			CHECK(value.unsubscribe(ids[i]));
+	}
+	for (int i = 0; i < 300; ++i) {
+		if (i % 3 != 0)
+			expected.push_back(i);
+	}
+	CHECK(value.subscriber_count() == 200);
+	value = 1;
+	CHECK(order == expected);
+
+	for (int i = 0; i < 300; ++i)
+		CHECK(value.unsubscribe(ids[i]) == (i % 3 != 0));
+	CHECK(value.subscriber_count() == 0);
+	order.clear();
+	value = 2;
+	CHECK(order.empty());
+
+	ids[0] = value.subscribe(recorders[7]);
+	value = 3;
+	CHECK(order == std::vector<int>{7});
+	CHECK(value.unsubscribe(ids[0]));
+}
+
+TEST_CASE("observable_attr skips subscribers unsubscribed earlier in a notification", "[observable_attr]")
+{
+	touka::observable_attr<int> value(0);
+	std::vector<int> order;
+	touka::observable_attr<int>::subscription third = 0;
+
+	auto first_callback = [&](const int&) {
+		order.push_back(1);
+		value.unsubscribe(third);
+	};
+	auto second_callback = [&order](const int&) { order.push_back(2); };
+	auto third_callback = [&order](const int&) { order.push_back(3); };
+	value.subscribe(first_callback);
+	value.subscribe(second_callback);
+	third = value.subscribe(third_callback);
+
+	value = 1;
+	CHECK(order == std::vector<int>{1, 2});
+	CHECK_FALSE(value.subscribed(third));
+	CHECK(value.subscriber_count() == 2);
+}
+
+TEST_CASE("observable_attr delivers writes made by subscribers in order", "[observable_attr]")
+{
+	touka::observable_attr<std::string> value("a");
+	std::vector<std::string> first_seen;
+	std::vector<std::string> second_seen;
+	std::vector<std::string> third_seen;
+
+	// The second subscriber appends to every value it has not extended yet.
+	auto first = [&first_seen](const std::string& v) { first_seen.push_back(v); };
+	auto second = [&](const std::string& v) {
+		second_seen.push_back(v);
+		if (v.size() < 3)
+			value = v + "+";
+	};
+	auto third = [&third_seen](const std::string& v) { third_seen.push_back(v); };
+	value.subscribe(first);
+	value.subscribe(second);
+	value.subscribe(third);
+
+	value = "b";
+	CHECK(first_seen == std::vector<std::string>{"b", "b+", "b++"});
+	CHECK(second_seen == std::vector<std::string>{"b", "b+", "b++"});
+	// Never handed a value that had already been overwritten, nor the same one twice.
+	CHECK(third_seen == std::vector<std::string>{"b++"});
+	CHECK(value.get() == "b++");
+
+	// The same holds when the first subscriber writes.
+	touka::observable_attr<int> number(0);
+	std::vector<int> writer_seen;
+	std::vector<int> reader_seen;
+	auto writer = [&](const int& v) {
+		writer_seen.push_back(v);
+		if (v == 1)
+			number = 2;
+	};
+	auto reader = [&reader_seen](const int& v) { reader_seen.push_back(v); };
+	number.subscribe(writer);
+	number.subscribe(reader);
+	number = 1;
+	CHECK(writer_seen == std::vector<int>{1, 2});
+	CHECK(reader_seen == std::vector<int>{2});
+}
+
+TEST_CASE("observable_attr keeps the first subscribers inline", "[observable_attr]")
+{
+	counted_observable<4> value(0);
+	int calls = 0;
+	auto count = [&calls](const int&) { ++calls; };
+
+	allocations = 0;
+	count_allocations = true;
+	value = 1;
+	for (int i = 0; i < 4; ++i)
+		value.subscribe(count);
+	value = 2;
+	count_allocations = false;
+	CHECK(allocations == 0);
+	CHECK(calls == 4);
+
+	// The callbacks and the slots their subscriptions refer to each move to the heap.
+	count_allocations = true;
+	value.subscribe(count);
+	count_allocations = false;
+	CHECK(allocations == 2);
+	value = 3;
+	CHECK(calls == 9);
+}
+
+TEST_CASE("notification_batch coalesces notifications", "[observable_attr][notification_batch]")
+{
+	touka::observable_attr<int> width(1);
+	touka::observable_attr<int> height(1);
+	touka::observable_attr<int> depth(1);
+	std::vector<int> widths;
+	int height_calls = 0;
+	int depth_calls = 0;
+	auto on_width = [&widths](const int& value) { widths.push_back(value); };
+	auto on_height = [&height_calls](const int&) { ++height_calls; };
+	auto on_depth = [&depth_calls](const int&) { ++depth_calls; };
+	width.subscribe(on_width);
+	height.subscribe(on_height);
+	depth.subscribe(on_depth);
+
+	{
+		touka::notification_batch batch;
+		for (int i = 2; i <= 40; ++i)
+			width = i;
+		height += 1;
+		height += 1;
+		depth = 1;  // Unchanged: nothing to deliver.
+		CHECK(widths.empty());
+		CHECK(height_calls == 0);
+	}
+	CHECK(widths == std::vector<int>{40});
+	CHECK(height_calls == 1);
+	CHECK(depth_calls == 0);
+
+	width = 41;  // Outside a batch, writes notify immediately again.
+	CHECK(widths == std::vector<int>{40, 41});
+}
+
+TEST_CASE("notification_batch nests", "[observable_attr][notification_batch]")
+{
+	touka::observable_attr<int> value;
+	int calls = 0;
+	auto count = [&calls](const int&) { ++calls; };
+	value.subscribe(count);
+
+	{
+		touka::notification_batch outer;
+		value = 1;
+		{
+			touka::notification_batch inner;
+			value = 2;
+		}
+		CHECK(calls == 0);
+		value = 3;
+	}
+	CHECK(calls == 1);
+}
+
+TEST_CASE("notification_batch coalesces writes made by callbacks", "[observable_attr][notification_batch]")
+{
+	touka::observable_attr<int> source;
+	touka::observable_attr<int> doubled;
+	touka::observable_attr<int> total;
+	std::vector<int> totals;
+	int total_updates = 0;
+
+	auto update_doubled = [&doubled](const int& value) { doubled = value * 2; };
+	auto update_total = [&](const int&) {
+		++total_updates;
+		total = source.get() + doubled.get();
+	};
+	auto record_total = [&totals](const int& value) { totals.push_back(value); };
+	source.subscribe(update_doubled);
+	source.subscribe(update_total);
+	doubled.subscribe(update_total);
+	total.subscribe(record_total);
+
+	{
+		touka::notification_batch batch;
+		source = 1;
+		source = 2;
+	}
+	// Without the batch, total would pass through the intermediate sum 2 + 0.
+	CHECK(totals == std::vector<int>{6});
+	// Subscribed to both source and doubled, update_total still runs once.
+	CHECK(total_updates == 1);
+}
+
+TEST_CASE("notification_batch calls each listener once", "[observable_attr][notification_batch]")
+{
+	touka::observable_attr<int> width(1);
+	touka::observable_attr<int> height(1);
+	std::vector<int> seen;
+	int other_calls = 0;
+	auto layout = [&seen](const int& value) { seen.push_back(value); };
+	auto other = [&other_calls](const int&) { ++other_calls; };
+	width.subscribe(layout);
+	height.subscribe(layout);
+	const auto other_id = height.subscribe(other);
+
+	{
+		touka::notification_batch batch;
+		width = 2;
+		height = 3;
+		width = 4;
+		height.unsubscribe(other_id);
+	}
+	// Once, with the value of the attr written last.
+	CHECK(seen == std::vector<int>{4});
+	CHECK(other_calls == 0);
+
+	{
+		touka::notification_batch batch;
+		height = 5;
+		height.subscribe(other);  // Subscribed after the first write, still called.
+		height = 6;
+	}
+	CHECK(seen == std::vector<int>{4, 6});
+	CHECK(other_calls == 1);
+}
+
+TEST_CASE("notification_batch forgets destroyed attrs", "[observable_attr][notification_batch]")
+{
+	touka::observable_attr<int> kept;
+	int calls = 0;
+	auto count = [&calls](const int&) { ++calls; };
+	kept.subscribe(count);
+
+	{
+		touka::notification_batch batch;
+		{
+			touka::observable_attr<int> temporary;
+			temporary.subscribe(count);
+			temporary = 1;
+		}
+		kept = 1;
+	}
+	CHECK(calls == 1);
+}
+
+TEST_CASE("observable_attr changed() resumes coroutines on changes", "[observable_attr][coroutine]")
+{
+	touka::observable_attr<int> value(0);
+	std::vector<int> seen;
+	watcher watch = record_changes(value, seen, 3);
+	CHECK(value.subscriber_count() == 1);
+
+	value = 1;
+	value = 1;  // Unchanged: stays suspended.
+	value = 2;
+	CHECK_FALSE(watch.done());
+	value += 1;
+	CHECK(watch.done());
+	CHECK(seen == std::vector<int>{1, 2, 3});
+	CHECK(value.subscriber_count() == 0);
+}
+
+TEST_CASE("observable_attr until() waits for its predicate", "[observable_attr][coroutine]")
+{
+	touka::observable_attr<int> value(10);
+	int result = 0;
+	watcher ready = wait_until_above(value, 5, result);
+	CHECK(ready.done());
+	CHECK(result == 10);
+
+	watcher waiting = wait_until_above(value, 20, result);
+	value = 15;
+	CHECK_FALSE(waiting.done());
+	value = 25;
+	CHECK(waiting.done());
+	CHECK(result == 25);
+}
+
+TEST_CASE("observable_attr awaiters resume through their executor", "[observable_attr][coroutine]")
+{
+	touka::observable_attr<int> value(0);
+	std::vector<std::coroutine_handle<>> queue;
+	std::vector<int> seen;
+	watcher watch = record_on(value, queue_executor{&queue}, seen);
+
+	value = 4;
+	CHECK(seen.empty());
+	REQUIRE(queue.size() == 1);
+	queue.front().resume();
+	CHECK(seen == std::vector<int>{4});
+	CHECK(watch.done());
+}
+
+TEST_CASE("observable_attr awaiters unsubscribe when their coroutine is destroyed", "[observable_attr][coroutine]")
+{
+	touka::observable_attr<int> value(0);
+	std::vector<int> seen;
+	{
+		watcher watch = record_changes(value, seen, 5);
+		CHECK(value.subscriber_count() == 1);
+	}
+	CHECK(value.subscriber_count() == 0);
+	value = 1;
+	CHECK(seen.empty());
+}
+
+TEST_CASE("observable_attr awaiters wake when a notification_batch ends", "[observable_attr][coroutine][notification_batch]")
+{
+	touka::observable_attr<int> value(0);
+	std::vector<int> seen;
+	watcher watch = record_changes(value, seen, 1);
+	{
+		touka::notification_batch batch;
+		value = 1;
+		value = 2;
+		CHECK_FALSE(watch.done());
+	}
+	CHECK(watch.done());
+	CHECK(seen == std::vector<int>{2});
+}
+
+TEST_CASE("observable_attr awaits do not allocate", "[observable_attr][coroutine]")
+{
+	counted_observable<> value(0);
+	int changes = 0;
+	watcher watch = count_changes(value, changes, 100);
+
+	allocations = 0;
+	count_allocations = true;
+	for (int i = 1; i <= 100; ++i)
+		value = i;
+	count_allocations = false;
+	CHECK(allocations == 0);
+	CHECK(changes == 100);
+	CHECK(watch.done());
+}
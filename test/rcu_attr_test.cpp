@@ -0,0 +1,173 @@
+//
+// Tests for rcu_attr.hpp.
+//
+
+#include <catch2/catch_all.hpp>
+#include "rcu_attr.hpp"
+
+#include <atomic>
+#include <map>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+	struct tracked_config
+	{
+		static inline std::atomic<int> live{0};
+
+		std::vector<int> values;
+
+		explicit tracked_config(std::vector<int> in = {}) : values(std::move(in)) { ++live; }
+		tracked_config(const tracked_config& other) : values(other.values) { ++live; }
+		tracked_config& operator=(const tracked_config&) = default;
+		~tracked_config() { --live; }
+	};
+
+	struct size_getter
+	{
+		std::size_t operator()(const std::map<std::string, int>& value) const { return value.size(); }
+	};
+
+	struct merge_setter
+	{
+		void operator()(std::map<std::string, int>& value, const std::map<std::string, int>& new_value) const
+		{
+			for (const auto& [key, v] : new_value)
+				value[key] = v;
+		}
+
+		void operator()(std::map<std::string, int>& value, std::map<std::string, int>&& new_value) const
+		{
+			(*this)(value, std::as_const(new_value));
+		}
+	};
+}
+
+TEST_CASE("rcu_attr basic operations", "[rcu_attr]")
+{
+	touka::rcu_attr<std::map<std::string, int>> config{std::map<std::string, int>{{"a", 1}}};
+	CHECK(config.read()->at("a") == 1);
+
+	config = std::map<std::string, int>{{"b", 2}};
+	CHECK(config.get().count("a") == 0);
+	CHECK((*config.read()).at("b") == 2);
+
+	config.modify([](auto& map) { map["c"] = 3; });
+	CHECK(config.get().size() == 2);
+
+	touka::rcu_attr<std::map<std::string, int>, size_getter, merge_setter> merged;
+	merged = std::map<std::string, int>{{"x", 1}};
+	merged = std::map<std::string, int>{{"y", 2}};
+	CHECK(merged.get() == 2);
+	CHECK(merged.read().get() == 2);
+}
+
+TEST_CASE("rcu_attr snapshots outlive writes", "[rcu_attr]")
+{
+	{
+		touka::rcu_attr<tracked_config> config{tracked_config({1, 2, 3})};
+		CHECK(tracked_config::live == 1);
+
+		std::thread reader;
+		std::atomic<bool> pinned{false};
+		std::atomic<bool> release{false};
+		std::atomic<bool> unchanged{false};
+		reader = std::thread([&] {
+			auto snapshot = config.read();
+			pinned = true;
+			while (!release)
+				std::this_thread::yield();
+			unchanged = snapshot->values == std::vector<int>{1, 2, 3};
+		});
+		while (!pinned)
+			std::this_thread::yield();
+
+		// The writer blocks in its grace period until the reader lets go.
+		std::thread writer([&] { config = tracked_config({4}); });
+		std::this_thread::yield();
+		release = true;
+		writer.join();
+		reader.join();
+
+		CHECK(unchanged.load());
+		CHECK(config.read()->values == std::vector<int>{4});
+		CHECK(tracked_config::live == 1);
+	}
+	CHECK(tracked_config::live == 0);
+}
+
+TEST_CASE("rcu_attr readers see whole versions under concurrent writes", "[rcu_attr]")
+{
+	constexpr unsigned reader_count = 3;
+	constexpr int write_count = 2000;
+
+	touka::rcu_attr<std::vector<int>> shared{std::vector<int>(64, 0)};
+	std::atomic<bool> done{false};
+	std::atomic<bool> inconsistent{false};
+
+	std::vector<std::thread> readers;
+	for (unsigned i = 0; i < reader_count; ++i) {
+		readers.emplace_back([&] {
+			while (!done.load(std::memory_order_relaxed)) {
+				auto snapshot = shared.read();
+				for (int value : *snapshot)
+					if (value != snapshot->front())
+						inconsistent = true;
+			}
+		});
+	}
+
+	for (int version = 1; version <= write_count; ++version)
+		shared = std::vector<int>(64, version);
+	done = true;
+	for (auto& reader : readers)
+		reader.join();
+
+	CHECK_FALSE(inconsistent.load());
+	CHECK(shared.read()->back() == write_count);
+}
+
+TEST_CASE("rcu_attr writes while the writer holds a snapshot", "[rcu_attr]")
+{
+	{
+		touka::rcu_domain domain;
+		touka::rcu_attr<tracked_config> config(domain, tracked_config({1}));
+		{
+			auto snapshot = config.read();
+			// Waiting for the grace period here would wait for this very snapshot.
+			config.set(tracked_config({snapshot->values[0] + 1}));
+			config.modify([](tracked_config& value) { value.values.push_back(3); });
+			CHECK(snapshot->values == std::vector<int>{1});
+			CHECK(config.read()->values == std::vector<int>{2, 3});
+			CHECK(tracked_config::live == 3);
+			CHECK(domain.pending() == 2);
+		}
+
+		// Once the snapshot is gone, a grace period reclaims the queue.
+		domain.synchronize();
+		CHECK(domain.pending() == 0);
+		CHECK(tracked_config::live == 1);
+
+		{
+			auto snapshot = config.read();
+			config.modify([](tracked_config& value) { value.values.push_back(4); });
+			CHECK(domain.pending() == 1);
+		}
+
+		// Outside any snapshot, the next write reclaims the deferred values too.
+		config = tracked_config({4});
+		CHECK(domain.pending() == 0);
+		CHECK(tracked_config::live == 1);
+
+		{
+			auto snapshot = config.read();
+			config = tracked_config({5});
+		}
+		CHECK(domain.pending() == 1);
+		CHECK(tracked_config::live == 2);
+	}
+	// The domain reclaims what is still deferred when it goes.
+	CHECK(tracked_config::live == 0);
+}
@@ -0,0 +1,166 @@
+//
+// Tests for seqlock_attr.hpp.
+//
+
+#include <catch2/catch_all.hpp>
+#include "seqlock_attr.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace {
+	// Every field carries the same stamp, so a torn read shows up as a mismatch.
+	struct snapshot
+	{
+		std::array<std::uint64_t, 12> stamps{};
+
+		explicit snapshot(std::uint64_t stamp = 0) { stamps.fill(stamp); }
+
+		bool operator==(const snapshot&) const = default;
+
+		bool consistent() const
+		{
+			for (auto stamp : stamps)
+				if (stamp != stamps[0])
+					return false;
+			return true;
+		}
+	};
+
+	struct stamp_getter
+	{
+		std::uint64_t operator()(const snapshot& value) const { return value.stamps[0]; }
+	};
+
+	struct capped_setter
+	{
+		void operator()(snapshot& value, const snapshot& new_value) const
+		{
+			value = new_value.stamps[0] > 100 ? snapshot(100) : new_value;
+		}
+	};
+}
+
+static_assert(sizeof(snapshot) == 96);
+
+TEST_CASE("seqlock_attr basic operations", "[seqlock_attr]")
+{
+	touka::seqlock_attr<snapshot> a;
+	CHECK(a.load().stamps[0] == 0);
+	CHECK(a.version() == 0);
+
+	a = snapshot(3);
+	CHECK(a.load().consistent());
+	CHECK(a.load().stamps[11] == 3);
+	CHECK(a.version() == 1);
+
+	auto published = a.modify([](snapshot& s) { s.stamps.fill(s.stamps[0] + 1); });
+	CHECK(published.stamps[5] == 4);
+	CHECK(a.version() == 2);
+
+	touka::seqlock_attr<snapshot, stamp_getter, capped_setter> capped{snapshot(1)};
+	CHECK(capped.get() == 1);
+	capped = snapshot(500);
+	CHECK(capped.get() == 100);
+	CHECK(capped.load().consistent());
+	capped.modify([](snapshot& s) { s.stamps.fill(7); });
+	CHECK(capped.get() == 7);
+}
+
+TEST_CASE("seqlock_attr writer exceptions leave the value intact", "[seqlock_attr]")
+{
+	touka::seqlock_attr<snapshot> a{snapshot(9)};
+	CHECK_THROWS(a.modify([](snapshot& s) {
+		s.stamps[0] = 1;
+		throw 1;
+	}));
+	CHECK(a.load().consistent());
+	CHECK(a.load().stamps[0] == 9);
+	a = snapshot(10);
+	CHECK(a.load().stamps[0] == 10);
+}
+
+TEST_CASE("seqlock_attr readers never observe torn values", "[seqlock_attr]")
+{
+	constexpr unsigned reader_count = 3;
+	constexpr std::uint64_t write_count = 20000;
+
+	touka::seqlock_attr<snapshot> shared;
+	std::atomic<bool> done{false};
+	std::atomic<bool> torn{false};
+	std::atomic<bool> went_backwards{false};
+
+	std::vector<std::thread> readers;
+	for (unsigned i = 0; i < reader_count; ++i) {
+		readers.emplace_back([&] {
+			std::uint64_t last = 0;
+			while (!done.load(std::memory_order_relaxed)) {
+				snapshot seen = shared.load();
+				if (!seen.consistent())
+					torn = true;
+				if (seen.stamps[0] < last)
+					went_backwards = true;
+				last = seen.stamps[0];
+			}
+		});
+	}
+
+	std::thread writer([&] {
+		for (std::uint64_t stamp = 1; stamp <= write_count; ++stamp)
+			shared = snapshot(stamp);
+	});
+	writer.join();
+	done = true;
+	for (auto& reader : readers)
+		reader.join();
+
+	CHECK_FALSE(torn.load());
+	CHECK_FALSE(went_backwards.load());
+	CHECK(shared.load().stamps[0] == write_count);
+}
+
+TEST_CASE("seqlock_attr serializes concurrent writers", "[seqlock_attr]")
+{
+	constexpr unsigned writer_count = 4;
+	constexpr int increments = 5000;
+
+	touka::seqlock_attr<snapshot> shared;
+	std::vector<std::thread> writers;
+	for (unsigned i = 0; i < writer_count; ++i) {
+		writers.emplace_back([&] {
+			for (int n = 0; n < increments; ++n)
+				shared.modify([](snapshot& s) { s.stamps.fill(s.stamps[0] + 1); });
+		});
+	}
+	for (auto& writer : writers)
+		writer.join();
+
+	CHECK(shared.load().consistent());
+	CHECK(shared.load().stamps[0] == std::uint64_t{writer_count} * increments);
+	CHECK(shared.version() == writer_count * increments);
+}
+
+TEST_CASE("seqlock_attr waiters wake on writes", "[seqlock_attr][wait]")
+{
+	touka::seqlock_attr<snapshot> shared;
+	const auto before = shared.version();
+
+	std::atomic<bool> woke{false};
+	std::thread waiter([&] {
+		shared.wait_for_change(before);
+		woke = true;
+	});
+	std::thread value_waiter([&] { shared.wait(snapshot(0)); });
+
+	std::this_thread::yield();
+	shared = snapshot(1);
+	waiter.join();
+	value_waiter.join();
+
+	CHECK(woke.load());
+	CHECK(shared.version() == before + 1);
+	shared.wait_for_change(before);
+}
@@ -0,0 +1,97 @@
+//
+// Tests for sharded_attr.hpp.
+//
+
+#include <catch2/catch_all.hpp>
+#include "sharded_attr.hpp"
+
+#include <compare>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace {
+	struct kilo_getter
+	{
+		double operator()(const std::uint64_t& value) const { return static_cast<double>(value) / 1000.0; }
+	};
+}
+
+TEST_CASE("sharded_attr basic operations", "[sharded_attr]")
+{
+	touka::sharded_attr<std::uint64_t> hits;
+	CHECK(hits.get() == 0);
+	CHECK((hits.shard_count() & (hits.shard_count() - 1)) == 0);
+
+	++hits;
+	hits++;
+	hits += 10;
+	hits -= 2;
+	CHECK(static_cast<std::uint64_t>(hits) == 10);
+	CHECK(hits == 10u);
+	CHECK(hits > 9u);
+	CHECK(hits > 0);
+	CHECK(0 < hits);
+	CHECK(hits != 11);
+
+	hits = 3;
+	CHECK(hits.load() == 3);
+
+	touka::sharded_attr<std::uint64_t> other(7, 4);
+	CHECK(other.shard_count() == 4);
+	CHECK(hits < other);
+	CHECK(hits != other);
+
+	touka::sharded_attr<std::uint64_t, kilo_getter> scaled(1500);
+	CHECK(scaled.get() == 1.5);
+	CHECK(scaled == 1.5);
+	CHECK(scaled > 1);
+	CHECK(scaled < 2u);
+
+	touka::sharded_attr<double> seconds(0.5, 3);
+	CHECK(seconds.shard_count() == 4);
+	seconds += 0.25;
+	CHECK(seconds.get() == 0.75);
+}
+
+TEST_CASE("sharded_attr compares with operands of other types as they are", "[sharded_attr]")
+{
+	touka::sharded_attr<int> two(2);
+	CHECK_FALSE(two == 2.5);
+	CHECK(two != 2.5);
+	CHECK(two < 2.5);
+	CHECK(two > 1.5);
+	CHECK(2.5 > two);
+	CHECK(two == 2.0);
+	CHECK(two == 2u);
+	CHECK(two < 3ull);
+
+	touka::sharded_attr<std::uint64_t> hits(10);
+	CHECK(hits > -1);
+	CHECK(hits != -1);
+	CHECK(-1 < hits);
+	CHECK(std::is_eq(hits <=> 10));
+
+	touka::sharded_attr<int> below(-1);
+	CHECK(below < 0u);
+	CHECK(below != UINT64_MAX);
+}
+
+TEST_CASE("sharded_attr loses no increments across threads", "[sharded_attr]")
+{
+	constexpr unsigned thread_count = 8;
+	constexpr int iterations = 20000;
+
+	touka::sharded_attr<std::uint64_t> counter;
+	std::vector<std::thread> threads;
+	for (unsigned i = 0; i < thread_count; ++i) {
+		threads.emplace_back([&] {
+			for (int n = 0; n < iterations; ++n)
+				++counter;
+		});
+	}
+	for (auto& thread : threads)
+		thread.join();
+
+	CHECK(counter.get() == std::uint64_t{thread_count} * iterations);
+}
@@ -0,0 +1,465 @@
+//
+// Tests for the synchronization policies in sync.hpp.
+//
+
+#include <catch2/catch_all.hpp>
+#include "sync.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <compare>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+	struct percent_setter
+	{
+		void operator()(int& value, const int& new_value) const { value = std::clamp(new_value, 0, 100); }
+	};
+
+	struct upper_getter
+	{
+		std::string operator()(const std::string& value) const
+		{
+			std::string upper = value;
+			for (char& c : upper)
+				c = static_cast<char>(c - 'a' + 'A');
+			return upper;
+		}
+	};
+
+	// Takes over compound assignment through the update() hook.
+	struct saturating_like_setter
+	{
+		void operator()(int& value, const int& new_value) const { value = std::min(new_value, 10); }
+
+		template<typename Op>
+		void update(int& value, Op op) const
+		{
+			op(value);
+			value = std::min(value, 10);
+		}
+	};
+
+	struct pair_snapshot
+	{
+		long first = 0;
+		long second = 0;
+	};
+
+	template<typename F>
+	void run_threads(unsigned count, F f)
+	{
+		std::vector<std::thread> threads;
+		for (unsigned i = 0; i < count; ++i)
+			threads.emplace_back([&f, i] { f(i); });
+		for (auto& thread : threads)
+			thread.join();
+	}
+
+	constexpr unsigned thread_count = 4;
+	constexpr int iterations = 5000;
+
+	using versioned_int = touka::attr_impl<int, touka::default_getter<int>, touka::default_setter<int>,
+		touka::sync::versioned<touka::sync::spinlock>>;
+
+	// An eagerly started coroutine that stays suspended at its end, so tests can check done().
+	struct watcher
+	{
+		struct promise_type
+		{
+			watcher get_return_object() { return watcher(std::coroutine_handle<promise_type>::from_promise(*this)); }
+			std::suspend_never initial_suspend() noexcept { return {}; }
+			std::suspend_always final_suspend() noexcept { return {}; }
+			void return_void() {}
+			void unhandled_exception() { std::terminate(); }
+		};
+
+		explicit watcher(std::coroutine_handle<promise_type> h) : handle(h) {}
+		watcher(watcher&& other) noexcept : handle(std::exchange(other.handle, {})) {}
+		~watcher()
+		{
+			if (handle)
+				handle.destroy();
+		}
+
+		bool done() const { return handle.done(); }
+
+		std::coroutine_handle<promise_type> handle;
+	};
+
+	watcher wait_until_at_least(const versioned_int& value, int limit, std::atomic<int>& result)
+	{
+		result = co_await value.until([limit](int v) { return v >= limit; });
+	}
+
+	watcher add_next_change(const versioned_int& value, std::atomic<int>& total)
+	{
+		total += co_await value.changed();
+	}
+
+	// Parks again after every change until it sees limit. The co_await stays out of the
+	// loop condition, which GCC 12 miscompiles.
+	watcher follow_changes(const versioned_int& value, int limit, std::atomic<int>& finished)
+	{
+		for (;;) {
+			const int seen = co_await value.changed();
+			if (seen >= limit)
+				break;
+		}
+		++finished;
+	}
+
+	watcher read_other_on_change(const versioned_int& value, const versioned_int& other, std::atomic<int>& seen)
+	{
+		co_await value.changed();
+		seen = other.get();
+	}
+}
+
+static_assert(!touka::attr_impl<int>::is_synchronized);
+static_assert(touka::attr<int, touka::default_getter<int>{}, touka::default_setter<int>{}, touka::sync::mutex>::is_synchronized);
+static_assert(!touka::attr_impl<int, touka::default_getter<int>, touka::default_setter<int>, touka::sync::spinlock>::has_trivial_copy);
+static_assert(!touka::is_trivially_relocatable_v<touka::attr_impl<int, touka::default_getter<int>, touka::default_setter<int>, touka::sync::mutex>>);
+static_assert(std::is_same_v<decltype(std::declval<const touka::attr_impl<std::string, touka::default_getter<std::string>, touka::default_setter<std::string>, touka::sync::mutex>&>().get()), std::string>);
+
+TEMPLATE_TEST_CASE("synchronized attrs lose no updates", "[sync]",
+	touka::sync::spinlock, touka::sync::mutex, touka::sync::shared_mutex, touka::sync::seqlock)
+{
+	SECTION("increments")
+	{
+		touka::attr_impl<long, touka::default_getter<long>, touka::default_setter<long>, TestType> counter(0L);
+		run_threads(thread_count, [&](unsigned) {
+			for (int i = 0; i < iterations; ++i) {
+				++counter;
+				counter += 2;
+				counter--;
+			}
+		});
+		CHECK(counter.get() == 2L * thread_count * iterations);
+	}
+
+	SECTION("setters run under the lock")
+	{
+		touka::attr_impl<int, touka::default_getter<int>, percent_setter, TestType> percent(0);
+		std::atomic<bool> out_of_range{false};
+		run_threads(thread_count, [&](unsigned) {
+			for (int i = 0; i < iterations; ++i) {
+				percent += 3;
+				int now = percent;
+				if (now < 0 || now > 100)
+					out_of_range = true;
+			}
+		});
+		CHECK_FALSE(out_of_range.load());
+		CHECK(percent == 100);
+	}
+
+	SECTION("readers see whole values")
+	{
+		touka::attr_impl<pair_snapshot, touka::default_getter<pair_snapshot>,
+			touka::default_setter<pair_snapshot>, TestType> shared;
+		std::atomic<bool> torn{false};
+		run_threads(thread_count, [&](unsigned index) {
+			for (int i = 0; i < iterations; ++i) {
+				if (index == 0) {
+					shared.modify([](pair_snapshot& value) {
+						++value.first;
+						++value.second;
+					});
+				} else {
+					pair_snapshot seen = shared.get();
+					if (seen.first != seen.second)
+						torn = true;
+				}
+			}
+		});
+		CHECK_FALSE(torn.load());
+		CHECK(shared.get().first == iterations);
+	}
+}
+
+TEMPLATE_TEST_CASE("synchronized pair operations do not deadlock", "[sync]",
+	touka::sync::spinlock, touka::sync::mutex, touka::sync::shared_mutex)
+{
+	using locked = touka::attr_impl<int, touka::default_getter<int>, touka::default_setter<int>, TestType>;
+	locked a(1);
+	locked b(2);
+
+	run_threads(thread_count, [&](unsigned index) {
+		for (int i = 0; i < iterations; ++i) {
+			if (index % 2 == 0) {
+				a.swap(b);
+				(void)(a < b);
+			} else {
+				swap(b, a);
+				(void)(b == a);
+			}
+		}
+	});
+
+	CHECK(a + b == 3);
+	CHECK(a != b);
+	CHECK(a == a);
+	CHECK(std::is_eq(a <=> a));
+}
+
+TEST_CASE("synchronized attrs keep the attr interface", "[sync]")
+{
+	using shared_name = touka::attr_impl<std::string, upper_getter, touka::default_setter<std::string>,
+		touka::sync::shared_mutex>;
+
+	shared_name name("ada");
+	CHECK(name.get() == "ADA");
+	CHECK(name->size() == 3);
+
+	shared_name copy(name);
+	name = "grace";
+	CHECK(*copy == "ADA");
+	CHECK(*name == "GRACE");
+	CHECK(copy < name);
+
+	copy = name;
+	CHECK(copy == name);
+
+	shared_name moved(std::move(copy));
+	CHECK(*moved == "GRACE");
+
+	name.emplace(3, 'z');
+	CHECK(*name == "ZZZ");
+	{
+		auto writer = name.write();
+		writer->push_back('z');
+	}
+	CHECK(name.get() == "ZZZZ");
+	CHECK(std::hash<shared_name>()(name) == std::hash<std::string>()("ZZZZ"));
+
+	touka::attr<std::string, touka::default_getter<std::string>{}, touka::default_setter<std::string>{},
+		touka::sync::mutex> plain("x");
+	std::string taken = std::move(plain);
+	CHECK(taken == "x");
+}
+
+TEST_CASE("seqlock attrs publish every write to readers", "[sync][seqlock]")
+{
+	using clamped = touka::attr_impl<int, touka::default_getter<int>, percent_setter, touka::sync::seqlock>;
+	using plain = touka::attr_impl<pair_snapshot, touka::default_getter<pair_snapshot>,
+		touka::default_setter<pair_snapshot>, touka::sync::versioned<touka::sync::seqlock>>;
+	STATIC_REQUIRE(clamped::publishes_value);
+	STATIC_REQUIRE(plain::publishes_value);
+	STATIC_REQUIRE_FALSE(touka::attr_impl<int, touka::default_getter<int>, touka::default_setter<int>,
+		touka::sync::mutex>::publishes_value);
+
+	clamped percent(50);
+	CHECK(percent == 50);
+	percent = 250;
+	CHECK(percent == 100);
+	clamped copy(percent);
+	CHECK(copy == 100);
+	percent = 40;
+	percent -= 50;
+	CHECK(percent == 0);
+	clamped moved(std::move(copy));
+	CHECK(moved == 100);
+	moved.swap(percent);
+	CHECK(moved == 0);
+	CHECK(percent == 100);
+
+	plain snapshot(std::in_place, pair_snapshot{1, 2});
+	CHECK(snapshot.get().second == 2);
+	snapshot.modify([](pair_snapshot& value) { value.first = 7; });
+	CHECK(snapshot.get().first == 7);
+	snapshot.write()->second = 8;
+	CHECK(snapshot.get().second == 8);
+	snapshot.emplace(pair_snapshot{3, 4});
+	CHECK(snapshot.get().first == 3);
+	CHECK(snapshot.version() == 3);
+}
+
+static_assert(sizeof(touka::attr<int>) == sizeof(int));
+static_assert(!touka::attr_impl<int, touka::default_getter<int>, touka::default_setter<int>,
+	touka::sync::versioned<>>::is_synchronized);
+static_assert(touka::attr_impl<int, touka::default_getter<int>, touka::default_setter<int>,
+	touka::sync::versioned<touka::sync::mutex>>::is_synchronized);
+
+TEST_CASE("versioned attrs count every write", "[sync][versioned]")
+{
+	using versioned_name = touka::attr<std::string, touka::default_getter<std::string>{},
+		touka::default_setter<std::string>{}, touka::sync::versioned<>>;
+
+	versioned_name name("a");
+	CHECK(name.version() == 0);
+	STATIC_REQUIRE(std::is_same_v<decltype(name.get()), const std::string&>);
+
+	name = "b";
+	CHECK(name.version() == 1);
+	name = std::string("c");
+	name.modify([](std::string& value) { value += "d"; });
+	name.write()->push_back('e');
+	name += "f";
+	name.emplace(2, 'g');
+	CHECK(name.version() == 6);
+	CHECK(*name == "gg");
+
+	versioned_name other("x");
+	name = other;
+	CHECK(name.version() == 7);
+	swap(name, other);
+	CHECK(name.version() == 8);
+	CHECK(other.version() == 1);
+
+	// Reads do not count.
+	(void)name.get();
+	(void)(name == other);
+	CHECK(name.version() == 8);
+
+	// Moving the value out changes it, so it counts for the source.
+	versioned_name moved(std::move(name));
+	CHECK(name.version() == 9);
+	CHECK(*moved == "x");
+	moved = std::move(other);
+	CHECK(other.version() == 2);
+	std::string taken = std::move(moved);
+	CHECK(taken == "x");
+	CHECK(moved.version() == 2);
+
+	touka::attr_impl<int, touka::default_getter<int>, saturating_like_setter, touka::sync::versioned<>> level(0);
+	level += 5;
+	level++;
+	CHECK(*level == 6);
+	CHECK(level.version() == 2);
+}
+
+TEST_CASE("versioned synchronized attrs count concurrent writes", "[sync][versioned]")
+{
+	touka::attr_impl<long, touka::default_getter<long>, touka::default_setter<long>,
+		touka::sync::versioned<touka::sync::shared_mutex>> counter(0L);
+
+	std::atomic<bool> went_backwards{false};
+	run_threads(thread_count, [&](unsigned index) {
+		std::uint64_t last = 0;
+		for (int i = 0; i < iterations; ++i) {
+			if (index == 0) {
+				std::uint64_t now = counter.version();
+				if (now < last)
+					went_backwards = true;
+				last = now;
+			} else {
+				++counter;
+			}
+		}
+	});
+
+	CHECK_FALSE(went_backwards.load());
+	CHECK(counter.get() == long{thread_count - 1} * iterations);
+	CHECK(counter.version() == std::uint64_t{thread_count - 1} * iterations);
+}
+
+TEST_CASE("versioned synchronized attrs wake waiters on writes", "[sync][versioned][wait]")
+{
+	touka::attr_impl<int, touka::default_getter<int>, touka::default_setter<int>,
+		touka::sync::versioned<touka::sync::spinlock>> ready(0);
+
+	std::atomic<int> seen{0};
+	std::thread waiter([&] {
+		ready.wait(0);
+		seen = ready;
+	});
+	std::thread version_waiter([&] { ready.wait_for_change(0); });
+
+	std::this_thread::yield();
+	ready = 0;  // Counts as a write, but the value has not changed yet.
+	ready = 7;
+	waiter.join();
+	version_waiter.join();
+
+	CHECK(seen.load() == 7);
+	CHECK(ready.version() == 2);
+}
+
+TEST_CASE("versioned synchronized attrs resume awaiting coroutines", "[sync][versioned][coroutine]")
+{
+	versioned_int counter(0);
+	std::atomic<int> result{0};
+	watcher ready = wait_until_at_least(counter, 0, result);
+	CHECK(ready.done());
+
+	watcher waiting = wait_until_at_least(counter, iterations, result);
+	std::thread writer([&] {
+		for (int i = 0; i < iterations; ++i)
+			++counter;
+	});
+	writer.join();
+
+	// Resumed on the writer's thread by the default inline executor.
+	CHECK(waiting.done());
+	CHECK(result.load() == iterations);
+}
+
+TEST_CASE("versioned synchronized attrs resume every awaiting coroutine", "[sync][versioned][coroutine]")
+{
+	versioned_int value(0);
+	std::atomic<int> total{0};
+	std::vector<watcher> watchers;
+	for (int i = 0; i < 1000; ++i)
+		watchers.push_back(add_next_change(value, total));
+	CHECK(total.load() == 0);
+
+	std::thread writer([&] { value = 3; });
+	writer.join();
+	CHECK(total.load() == 3000);
+	CHECK(std::all_of(watchers.begin(), watchers.end(), [](const watcher& w) { return w.done(); }));
+
+	// Destroying suspended coroutines unlinks them.
+	std::vector<watcher> abandoned;
+	for (int i = 0; i < 10; ++i)
+		abandoned.push_back(add_next_change(value, total));
+	for (int i = 3; i < 7; ++i)
+		std::exchange(abandoned[i].handle, {}).destroy();
+	value = 1;
+	CHECK(total.load() == 3006);
+}
+
+TEST_CASE("versioned synchronized attrs resume coroutines parking while others write", "[sync][versioned][coroutine]")
+{
+	versioned_int counter(0);
+	constexpr int limit = iterations;
+	std::atomic<int> finished{0};
+	std::vector<std::optional<watcher>> watchers(thread_count);
+
+	// Every coroutine first parks on its own thread, racing with the writer, and from then
+	// on parks again from inside the writer's wake-ups.
+	std::thread writer([&] {
+		while (finished.load() < static_cast<int>(thread_count))
+			++counter;
+	});
+	run_threads(thread_count, [&](unsigned index) { watchers[index].emplace(follow_changes(counter, limit, finished)); });
+	writer.join();
+
+	CHECK(finished.load() == static_cast<int>(thread_count));
+	CHECK(std::all_of(watchers.begin(), watchers.end(), [](const std::optional<watcher>& w) { return w->done(); }));
+	CHECK(counter.get() >= limit);
+}
+
+TEST_CASE("versioned synchronized attrs resume coroutines after swap unlocks both", "[sync][versioned][coroutine]")
+{
+	versioned_int a(1);
+	versioned_int b(2);
+	std::atomic<int> seen_from_a{0};
+	std::atomic<int> seen_from_b{0};
+	watcher on_a = read_other_on_change(a, b, seen_from_a);
+	watcher on_b = read_other_on_change(b, a, seen_from_b);
+
+	// Each coroutine reads the other attr on the swapping thread; neither lock may still be held.
+	a.swap(b);
+	CHECK(on_a.done());
+	CHECK(on_b.done());
+	CHECK(seen_from_a.load() == 1);
+	CHECK(seen_from_b.load() == 2);
+}
@@ -2,7 +2,12 @@ add_requires("catch2 3.x", { alias = "catch2" })
 
 target("test")
     set_kind("binary")  -- 定义为可执行文件
-    add_files("attr_test.cpp")
+    add_files("attr_test.cpp", "atomic_attr_test.cpp", "seqlock_attr_test.cpp", "rcu_attr_test.cpp", "sharded_attr_test.cpp",
+              "sync_test.cpp", "observable_attr_test.cpp", "computed_attr_test.cpp",
+              "async_attr_test.cpp", "memoized_getter_test.cpp")
     add_packages("catch2")
     add_deps("attr")
-    add_includedirs("../include/attr")
\ No newline at end of file
+    add_includedirs("../include/attr")
+    if is_plat("linux") then
+        add_syslinks("pthread")
+    end
@@ -79,6 +79,16 @@ if has_config("test_on") then
     includes("test")
 end
 
+option("benchmark_on")
+    set_default(false)
+    set_showmenu(true)
+    set_description("Enable benchmark build")
+option_end()
+
+if has_config("benchmark_on") then
+    includes("benchmark")
+end
+
 -- target("test")
 --     set_kind("binary")  -- 定义为可执行文件
 --     add_files("attr_module_test.cpp")